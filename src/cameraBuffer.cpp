@@ -0,0 +1,33 @@
+#include "cameraBuffer.h"
+
+#include <glad/glad.h>
+
+void CameraBuffer::create()
+{
+    glGenBuffers(1, &ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, ubo);
+}
+
+/**
+ * Uploads the camera matrices if they differ from the ones already in the buffer.
+ * Returns true if the buffer was written.
+ */
+bool CameraBuffer::update(const glm::mat4& projection, const glm::mat4& view, const glm::mat4& parent)
+{
+    if (isWritten && block.projection == projection && block.view == view && block.parent == parent)
+    {
+        return false;
+    }
+
+    block.projection = projection;
+    block.view = view;
+    block.parent = parent;
+    isWritten = true;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+
+    return true;
+}
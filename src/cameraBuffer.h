@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Binding point of the Camera uniform block, shared by every shader program.
+#define CAMERA_BLOCK_BINDING 0
+
+// GLSL declaration of the Camera uniform block, for inclusion in shader sources.
+#define CAMERA_BLOCK_SOURCE \
+    "layout (std140) uniform Camera\n" \
+    "{\n" \
+    "   mat4 projection;\n" \
+    "   mat4 view;\n" \
+    "   mat4 parent;\n" /* rotation of the whole cube (terrain, snake, apples) */ \
+    "};\n"
+
+/**
+ * Uniform buffer holding the per-frame camera data (std140 layout of the Camera block).
+ * 
+ * The buffer is only written when the data actually changes, and it is bound
+ * to CAMERA_BLOCK_BINDING, so every program declaring the Camera block reads it.
+ */
+class CameraBuffer
+{
+    // std140 layout: three column major mat4, no padding needed
+    struct Block
+    {
+        glm::mat4 projection;
+        glm::mat4 view;
+        glm::mat4 parent;
+    };
+
+    unsigned int ubo = 0;
+    Block block;
+    bool isWritten = false;
+
+public:
+    void create();
+    bool update(const glm::mat4& projection, const glm::mat4& view, const glm::mat4& parent);
+};
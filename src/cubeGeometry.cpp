@@ -0,0 +1,480 @@
+#include "cubeGeometry.h"
+#include <algorithm>
+#include <cmath>
+
+// Unit cube, two triangles per face, centered at the origin.
+const float CUBE_POSITIONS[CUBE_VERTEX_COUNT * 3] = 
+{
+    // Front face
+    // A, C, B
+    -0.5f,  0.5f,  0.5f,
+    -0.5f, -0.5f,  0.5f,
+    0.5f,  0.5f,  0.5f,
+    // D, B, C
+    0.5f, -0.5f,  0.5f,
+    0.5f,  0.5f,  0.5f,
+    -0.5f, -0.5f,  0.5f,
+
+    // Back face
+    // E, F, G
+    -0.5f,  0.5f, -0.5f,
+    0.5f,  0.5f, -0.5f,
+    -0.5f, -0.5f, -0.5f,
+    // H, G, F
+    0.5f, -0.5f, -0.5f,
+    -0.5f, -0.5f, -0.5f,
+    0.5f,  0.5f, -0.5f,
+
+    // Top face
+    // E, A, F
+    -0.5f,  0.5f, -0.5f,
+    -0.5f,  0.5f,  0.5f,
+    0.5f,  0.5f, -0.5f,
+    // B, F, A
+    0.5f,  0.5f,  0.5f,
+    0.5f,  0.5f, -0.5f,
+    -0.5f,  0.5f,  0.5f,
+
+    // Left face
+    // A, E, C
+    -0.5f,  0.5f,  0.5f,
+    -0.5f,  0.5f, -0.5f,
+    -0.5f, -0.5f,  0.5f,
+    // G, C, E
+    -0.5f, -0.5f, -0.5f,
+    -0.5f, -0.5f,  0.5f,
+    -0.5f,  0.5f, -0.5f,
+
+    // Right face
+    // B, D, F
+    0.5f,  0.5f,  0.5f,
+    0.5f, -0.5f,  0.5f,
+    0.5f,  0.5f, -0.5f,
+    // H, F, D
+    0.5f, -0.5f, -0.5f,
+    0.5f,  0.5f, -0.5f,
+    0.5f, -0.5f,  0.5f,
+
+    // Bottom face
+    // G, H, C
+    -0.5f, -0.5f, -0.5f,
+    0.5f, -0.5f, -0.5f,
+    -0.5f, -0.5f,  0.5f,
+    // D, C, H
+    0.5f, -0.5f,  0.5f,
+    -0.5f, -0.5f,  0.5f,
+    0.5f, -0.5f, -0.5f
+};
+
+// Plain dirt block.
+static const float DIRT_TEX_COORDS[] = 
+{
+    // Front face
+    // A, C, B
+    2.0f/4.0f, 4.0f/6.0f,
+    2.0f/4.0f, 3.0f/6.0f,
+    3.0f/4.0f, 4.0f/6.0f,
+    // D, B, C
+    3.0f/4.0f, 3.0f/6.0f,
+    3.0f/4.0f, 4.0f/6.0f,
+    2.0f/4.0f, 3.0f/6.0f,
+
+    // Back face
+    // E, F, G
+    3.0f/4.0f, 4.0f/6.0f,
+    2.0f/4.0f, 4.0f/6.0f,
+    3.0f/4.0f, 3.0f/6.0f,
+    // H, G, F
+    2.0f/4.0f, 3.0f/6.0f,
+    3.0f/4.0f, 3.0f/6.0f,
+    2.0f/4.0f, 4.0f/6.0f,
+
+    // Top face
+    // E, A, F
+    2.0f/4.0f, 4.0f/6.0f,
+    2.0f/4.0f, 3.0f/6.0f,
+    3.0f/4.0f, 4.0f/6.0f,
+    // B, F, A
+    3.0f/4.0f, 3.0f/6.0f,
+    3.0f/4.0f, 4.0f/6.0f,
+    2.0f/4.0f, 3.0f/6.0f,
+
+    // Left face
+    // A, E, C
+    3.0f/4.0f, 4.0f/6.0f,
+    2.0f/4.0f, 4.0f/6.0f,
+    3.0f/4.0f, 3.0f/6.0f,
+    // G, C, E
+    2.0f/4.0f, 3.0f/6.0f,
+    3.0f/4.0f, 3.0f/6.0f,
+    2.0f/4.0f, 4.0f/6.0f,
+
+    // Right face
+    // B, D, F
+    2.0f/4.0f, 4.0f/6.0f,
+    2.0f/4.0f, 3.0f/6.0f,
+    3.0f/4.0f, 4.0f/6.0f,
+    // H, F, D
+    3.0f/4.0f, 3.0f/6.0f,
+    3.0f/4.0f, 4.0f/6.0f,
+    2.0f/4.0f, 3.0f/6.0f,
+
+    // Bottom face
+    // G, H, C
+    2.0f/4.0f, 3.0f/6.0f,
+    3.0f/4.0f, 3.0f/6.0f,
+    2.0f/4.0f, 4.0f/6.0f,
+    // D, C, H
+    3.0f/4.0f, 4.0f/6.0f,
+    2.0f/4.0f, 4.0f/6.0f,
+    3.0f/4.0f, 3.0f/6.0f,
+};
+
+// Dirt block with grass on top (top layer of the terrain).
+static const float DIRT_WITH_GRASS_TEX_COORDS[] = 
+{
+    // Front face
+    // A, C, B
+    0.0f/4.0f, 4.0f/6.0f,
+    0.0f/4.0f, 3.0f/6.0f,
+    1.0f/4.0f, 4.0f/6.0f,
+    // D, B, C
+    1.0f/4.0f, 3.0f/6.0f,
+    1.0f/4.0f, 4.0f/6.0f,
+    0.0f/4.0f, 3.0f/6.0f,
+
+    // Back face
+    // E, F, G
+    1.0f/4.0f, 4.0f/6.0f,
+    0.0f/4.0f, 4.0f/6.0f,
+    1.0f/4.0f, 3.0f/6.0f,
+    // H, G, F
+    0.0f/4.0f, 3.0f/6.0f,
+    1.0f/4.0f, 3.0f/6.0f,
+    0.0f/4.0f, 4.0f/6.0f,
+
+    // Top face
+    // E, A, F
+    1.0f/4.0f, 4.0f/6.0f,
+    1.0f/4.0f, 3.0f/6.0f,
+    2.0f/4.0f, 4.0f/6.0f,
+    // B, F, A
+    2.0f/4.0f, 3.0f/6.0f,
+    2.0f/4.0f, 4.0f/6.0f,
+    1.0f/4.0f, 3.0f/6.0f,
+
+    // Left face
+    // A, E, C
+    1.0f/4.0f, 4.0f/6.0f,
+    0.0f/4.0f, 4.0f/6.0f,
+    1.0f/4.0f, 3.0f/6.0f,
+    // G, C, E
+    0.0f/4.0f, 3.0f/6.0f,
+    1.0f/4.0f, 3.0f/6.0f,
+    0.0f/4.0f, 4.0f/6.0f,
+
+    // Right face
+    // B, D, F
+    0.0f/4.0f, 4.0f/6.0f,
+    0.0f/4.0f, 3.0f/6.0f,
+    1.0f/4.0f, 4.0f/6.0f,
+    // H, F, D
+    1.0f/4.0f, 3.0f/6.0f,
+    1.0f/4.0f, 4.0f/6.0f,
+    0.0f/4.0f, 3.0f/6.0f,
+
+    // Bottom face
+    // G, H, C
+    2.0f/4.0f, 4.0f/6.0f,
+    3.0f/4.0f, 4.0f/6.0f,
+    2.0f/4.0f, 3.0f/6.0f,
+    // D, C, H
+    3.0f/4.0f, 3.0f/6.0f,
+    2.0f/4.0f, 3.0f/6.0f,
+    3.0f/4.0f, 4.0f/6.0f,
+};
+
+// Apple.
+static const float APPLE_TEX_COORDS[] = 
+{
+    // Front face
+    // A, C, B
+    3.0f/4.0f, 5.0f/6.0f,
+    3.0f/4.0f, 4.0f/6.0f,
+    4.0f/4.0f, 5.0f/6.0f,
+    // D, B, C
+    4.0f/4.0f, 4.0f/6.0f,
+    4.0f/4.0f, 5.0f/6.0f,
+    3.0f/4.0f, 4.0f/6.0f,
+
+    // Back face
+    // E, F, G
+    2.0f/4.0f, 5.0f/6.0f,
+    1.0f/4.0f, 5.0f/6.0f,
+    2.0f/4.0f, 4.0f/6.0f,
+    // H, G, F
+    1.0f/4.0f, 4.0f/6.0f,
+    2.0f/4.0f, 4.0f/6.0f,
+    1.0f/4.0f, 5.0f/6.0f,
+
+    // Top face
+    // E, A, F
+    1.0f/4.0f, 5.0f/6.0f,
+    1.0f/4.0f, 4.0f/6.0f,
+    2.0f/4.0f, 5.0f/6.0f,
+    // B, F, A
+    2.0f/4.0f, 4.0f/6.0f,
+    2.0f/4.0f, 5.0f/6.0f,
+    1.0f/4.0f, 4.0f/6.0f,
+
+    // Left face
+    // A, E, C
+    3.0f/4.0f, 5.0f/6.0f,
+    2.0f/4.0f, 5.0f/6.0f,
+    3.0f/4.0f, 4.0f/6.0f,
+    // G, C, E
+    2.0f/4.0f, 4.0f/6.0f,
+    3.0f/4.0f, 4.0f/6.0f,
+    2.0f/4.0f, 5.0f/6.0f,
+
+    // Right face
+    // B, D, F
+    4.0f/4.0f, 4.0f/6.0f,
+    4.0f/4.0f, 5.0f/6.0f,
+    3.0f/4.0f, 4.0f/6.0f,
+    // H, F, D
+    3.0f/4.0f, 5.0f/6.0f,
+    3.0f/4.0f, 4.0f/6.0f,
+    4.0f/4.0f, 5.0f/6.0f,
+
+    // Bottom face
+    // G, H, C
+    1.0f/4.0f, 4.0f/6.0f,
+    2.0f/4.0f, 4.0f/6.0f,
+    1.0f/4.0f, 5.0f/6.0f,
+    // D, C, H
+    2.0f/4.0f, 5.0f/6.0f,
+    1.0f/4.0f, 5.0f/6.0f,
+    2.0f/4.0f, 4.0f/6.0f,
+};
+
+// Worm head, faces forward (+z).
+static const float WORM_HEAD_TEX_COORDS[] = 
+{
+    // Front face
+    // A, C, B
+    0.0f/4.0f, 6.0f/6.0f,
+    0.0f/4.0f, 5.0f/6.0f,
+    1.0f/4.0f, 6.0f/6.0f,
+    // D, B, C
+    1.0f/4.0f, 5.0f/6.0f,
+    1.0f/4.0f, 6.0f/6.0f,
+    0.0f/4.0f, 5.0f/6.0f,
+
+    // Back face
+    // E, F, G
+    1.0f/4.0f, 3.0f/6.0f,
+    0.0f/4.0f, 3.0f/6.0f,
+    1.0f/4.0f, 2.0f/6.0f,
+    // H, G, F
+    0.0f/4.0f, 2.0f/6.0f,
+    1.0f/4.0f, 2.0f/6.0f,
+    0.0f/4.0f, 3.0f/6.0f,
+
+    // Top face
+    // E, A, F
+    3.0f/4.0f, 5.0f/6.0f,
+    3.0f/4.0f, 6.0f/6.0f,
+    2.0f/4.0f, 5.0f/6.0f,
+    // B, F, A
+    2.0f/4.0f, 6.0f/6.0f,
+    2.0f/4.0f, 5.0f/6.0f,
+    3.0f/4.0f, 6.0f/6.0f,
+
+    // Left face
+    // A, E, C
+    2.0f/4.0f, 6.0f/6.0f,
+    2.0f/4.0f, 5.0f/6.0f,
+    1.0f/4.0f, 6.0f/6.0f,
+    // G, C, E
+    1.0f/4.0f, 5.0f/6.0f,
+    1.0f/4.0f, 6.0f/6.0f,
+    2.0f/4.0f, 5.0f/6.0f,
+
+    // Right face
+    // B, D, F
+    2.0f/4.0f, 6.0f/6.0f,
+    1.0f/4.0f, 6.0f/6.0f,
+    2.0f/4.0f, 5.0f/6.0f,
+    // H, F, D
+    1.0f/4.0f, 5.0f/6.0f,
+    2.0f/4.0f, 5.0f/6.0f,
+    1.0f/4.0f, 6.0f/6.0f,
+
+    // Bottom face
+    // G, H, C
+    2.0f/4.0f, 5.0f/6.0f,
+    3.0f/4.0f, 5.0f/6.0f,
+    2.0f/4.0f, 6.0f/6.0f,
+    // D, C, H
+    3.0f/4.0f, 6.0f/6.0f,
+    2.0f/4.0f, 6.0f/6.0f,
+    3.0f/4.0f, 5.0f/6.0f,
+};
+
+// Worm body, has no front face (it is always covered by the next part).
+static const float WORM_BODY_TEX_COORDS[] = 
+{
+    // Back face
+    // E, F, G
+    1.0f/4.0f, 5.0f/6.0f,
+    0.0f/4.0f, 5.0f/6.0f,
+    1.0f/4.0f, 4.0f/6.0f,
+    // H, G, F
+    0.0f/4.0f, 4.0f/6.0f,
+    1.0f/4.0f, 4.0f/6.0f,
+    0.0f/4.0f, 5.0f/6.0f,
+
+    // Top face
+    // E, A, F
+    4.0f/4.0f, 5.0f/6.0f,
+    4.0f/4.0f, 6.0f/6.0f,
+    3.0f/4.0f, 5.0f/6.0f,
+    // B, F, A
+    3.0f/4.0f, 6.0f/6.0f,
+    3.0f/4.0f, 5.0f/6.0f,
+    4.0f/4.0f, 6.0f/6.0f,
+
+    // Left face
+    // A, E, C
+    3.0f/4.0f, 6.0f/6.0f,
+    3.0f/4.0f, 5.0f/6.0f,
+    4.0f/4.0f, 6.0f/6.0f,
+    // G, C, E
+    4.0f/4.0f, 5.0f/6.0f,
+    4.0f/4.0f, 6.0f/6.0f,
+    3.0f/4.0f, 5.0f/6.0f,
+
+    // Right face
+    // B, D, F
+    4.0f/4.0f, 6.0f/6.0f,
+    3.0f/4.0f, 6.0f/6.0f,
+    4.0f/4.0f, 5.0f/6.0f,
+    // H, F, D
+    3.0f/4.0f, 5.0f/6.0f,
+    4.0f/4.0f, 5.0f/6.0f,
+    3.0f/4.0f, 6.0f/6.0f,
+
+    // Bottom face
+    // G, H, C
+    3.0f/4.0f, 5.0f/6.0f,
+    4.0f/4.0f, 5.0f/6.0f,
+    3.0f/4.0f, 6.0f/6.0f,
+    // D, C, H
+    4.0f/4.0f, 6.0f/6.0f,
+    3.0f/4.0f, 6.0f/6.0f,
+    4.0f/4.0f, 5.0f/6.0f,
+};
+
+/**
+ * Texture coordinates of every vertex of a cube variant. They line up with
+ * CUBE_POSITIONS, starting at vertex getCubeFirstVertex(variant).
+ */
+const float * getCubeTexCoords(CubeVariant variant)
+{
+    switch (variant)
+    {
+        case CubeVariant::Dirt:          return DIRT_TEX_COORDS;
+        case CubeVariant::DirtWithGrass: return DIRT_WITH_GRASS_TEX_COORDS;
+        case CubeVariant::Apple:         return APPLE_TEX_COORDS;
+        case CubeVariant::WormHead:      return WORM_HEAD_TEX_COORDS;
+        default:                         return WORM_BODY_TEX_COORDS;
+    }
+}
+
+/**
+ * First vertex of CUBE_POSITIONS a cube variant uses (the worm body skips the front face).
+ */
+int getCubeFirstVertex(CubeVariant variant)
+{
+    return (variant == CubeVariant::WormBody) ? 6 : 0;
+}
+
+/**
+ * Atlas tile a face of the given texture coordinates samples from, along axis
+ * (0: column, 1: row). Every face maps onto one whole tile, this is its lowest edge.
+ */
+int getCubeFaceTile(const float * texCoords, int face, int axis, int tiles)
+{
+    int tile = tiles;
+    for (int v = face * 6; v < face * 6 + 6; v++)
+    {
+        tile = std::min(tile, (int) round(texCoords[v * 2 + axis] * tiles));
+    }
+
+    return tile;
+}
+
+// Texture array layer of an atlas tile.
+int getAtlasLayer(int tileColumn, int tileRow)
+{
+    return tileRow * ATLAS_COLUMNS + tileColumn;
+}
+
+/**
+ * Builds the packed vertices and indices of every cube variant, back to back,
+ * and stores the index range of each variant, so all of them can be drawn
+ * from a single buffer.
+ * 
+ * Corners shared by the two triangles of a face are stored once, so a full
+ * cube has 24 unique vertices and 36 indices.
+ */
+void buildCubeGeometry(std::vector<CubeVertex>& vertices, std::vector<unsigned char>& indices, CubeVariantRange ranges[CUBE_VARIANT_COUNT])
+{
+    vertices.clear();
+    indices.clear();
+
+    for (int i = 0; i < CUBE_VARIANT_COUNT; i++)
+    {
+        const CubeVariant variant = (CubeVariant) i;
+        const float * texCoords = getCubeTexCoords(variant);
+        const int firstVertex = getCubeFirstVertex(variant);
+
+        ranges[i].firstIndex = indices.size();
+        ranges[i].indexCount = CUBE_VERTEX_COUNT - firstVertex;
+        ranges[i].baseVertex = vertices.size();
+
+        for (int v = 0; v < ranges[i].indexCount; v++)
+        {
+            CubeVertex vertex = {};
+            vertex.x = (signed char) round(CUBE_POSITIONS[(firstVertex + v) * 3 + 0] * 2.0f);
+            vertex.y = (signed char) round(CUBE_POSITIONS[(firstVertex + v) * 3 + 1] * 2.0f);
+            vertex.z = (signed char) round(CUBE_POSITIONS[(firstVertex + v) * 3 + 2] * 2.0f);
+
+            // tile-local coordinates in the face's tile, and the tile's layer
+            const int tileColumn = getCubeFaceTile(texCoords, v / 6, 0, ATLAS_COLUMNS);
+            const int tileRow = getCubeFaceTile(texCoords, v / 6, 1, ATLAS_ROWS);
+            vertex.u = (unsigned char) (round(texCoords[v * 2 + 0] * ATLAS_COLUMNS) - tileColumn);
+            vertex.v = (unsigned char) (round(texCoords[v * 2 + 1] * ATLAS_ROWS) - tileRow);
+            vertex.layer = (unsigned char) getAtlasLayer(tileColumn, tileRow);
+
+            // reuse the vertex if this variant already has it
+            int index = ranges[i].baseVertex;
+            while (
+                index < (int) vertices.size() && 
+                !(vertices[index].x == vertex.x && vertices[index].y == vertex.y && vertices[index].z == vertex.z && 
+                  vertices[index].u == vertex.u && vertices[index].v == vertex.v && vertices[index].layer == vertex.layer)
+            )
+            {
+                index++;
+            }
+
+            if (index == (int) vertices.size())
+            {
+                vertices.push_back(vertex);
+            }
+
+            indices.push_back(index - ranges[i].baseVertex);
+        }
+    }
+}
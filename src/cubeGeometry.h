@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+// Vertices of a full cube (6 faces, 2 triangles each)
+#define CUBE_VERTEX_COUNT 36
+
+// Texture atlas layout (tiles per row and column)
+#define ATLAS_COLUMNS 4
+#define ATLAS_ROWS 6
+
+// The atlas is sliced into a texture array at load time, one layer per tile,
+// row by row from the bottom (see getAtlasLayer()).
+#define ATLAS_LAYER_COUNT (ATLAS_COLUMNS * ATLAS_ROWS)
+
+// Textured variants of the unit cube.
+enum class CubeVariant
+{
+    Dirt, DirtWithGrass, Apple, WormHead, WormBody
+};
+
+#define CUBE_VARIANT_COUNT 5
+
+// Rotation of an entity cube heading in each Direction (Up, Down, Right, Left, Forward,
+// Backward), column major. The unrotated cube heads Forward (+z).
+// Only six orientations exist, so they are never built with trig at run time.
+constexpr float DIRECTION_ROTATIONS[6][9] =
+{
+    {1, 0, 0,   0, 0, -1,   0, 1, 0},   // Up: -90 about x
+    {1, 0, 0,   0, 0, 1,    0, -1, 0},  // Down: 90 about x
+    {0, 0, -1,  0, 1, 0,    1, 0, 0},   // Right: 90 about y
+    {0, 0, 1,   0, 1, 0,    -1, 0, 0},  // Left: -90 about y
+    {1, 0, 0,   0, 1, 0,    0, 0, 1},   // Forward: no rotation
+    {-1, 0, 0,  0, 1, 0,    0, 0, -1}   // Backward: 180 about y
+};
+
+// Packed cube vertex (8 bytes).
+// Positions are in half units (+-1 is +-0.5), texture coordinates are tile-local
+// (0 or 1) plus the atlas layer of the tile, so all are exact small integers.
+struct CubeVertex
+{
+    signed char x, y, z, padding;
+    unsigned char u, v, layer, padding2;
+};
+
+// Index range of a cube variant in the shared cube geometry.
+// Indices are relative to baseVertex.
+struct CubeVariantRange
+{
+    int firstIndex;
+    int indexCount;
+    int baseVertex;
+};
+
+// Faces in order: front (+z), back (-z), top (+y), left (-x), right (+x), bottom (-y).
+extern const float CUBE_POSITIONS[CUBE_VERTEX_COUNT * 3];
+
+const float * getCubeTexCoords(CubeVariant variant);
+int getCubeFirstVertex(CubeVariant variant);
+int getCubeFaceTile(const float * texCoords, int face, int axis, int tiles);
+int getAtlasLayer(int tileColumn, int tileRow);
+void buildCubeGeometry(std::vector<CubeVertex>& vertices, std::vector<unsigned char>& indices, CubeVariantRange ranges[CUBE_VARIANT_COUNT]);
@@ -0,0 +1,67 @@
+#include "fixedTimestep.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * tickLength: seconds per tick.
+ * maxTicksPerAdvance: ticks a single advance() may return. After a long stall
+ * (window dragged, debugger) the backlog beyond it is dropped instead of being
+ * simulated in one burst.
+ */
+FixedTimestep::FixedTimestep(double tickLength, int maxTicksPerAdvance)
+{
+    this->tickLength = tickLength;
+    this->maxTicksPerAdvance = maxTicksPerAdvance;
+}
+
+double FixedTimestep::getTickLength() const
+{
+    return tickLength;
+}
+
+/**
+ * Moves the scheduler to time (seconds) and returns the number of ticks to
+ * simulate. The first call only sets the starting time.
+ */
+int FixedTimestep::advance(double time)
+{
+    if (!isStarted)
+    {
+        isStarted = true;
+        startTime = time;
+        lastTime = time;
+        return 0;
+    }
+
+    lastTime = std::max(time, lastTime);
+
+    const unsigned long dueTickCount = (unsigned long) std::floor((lastTime - startTime) / tickLength);
+    unsigned long ticks = dueTickCount - scheduledTickCount;
+    scheduledTickCount = dueTickCount;
+
+    if (ticks > (unsigned long) maxTicksPerAdvance)
+    {
+        droppedTickCount += ticks - maxTicksPerAdvance;
+        ticks = maxTicksPerAdvance;
+    }
+
+    tickCount += ticks;
+    return (int) ticks;
+}
+
+// Progress into the next tick, 0 right after a tick and approaching 1 just before the next.
+double FixedTimestep::getAlpha() const
+{
+    return (lastTime - startTime) / tickLength - scheduledTickCount;
+}
+
+unsigned long FixedTimestep::getTickCount() const
+{
+    return tickCount;
+}
+
+unsigned long FixedTimestep::getDroppedTickCount() const
+{
+    return droppedTickCount;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+/**
+ * Fixed-timestep scheduler.
+ *
+ * advance() is handed the current time and returns how many ticks of tickLength
+ * seconds are due since the last call. Ticks are counted from the starting time
+ * rather than accumulated per call, so rounding never drifts the schedule. getAlpha() is
+ * how far the current time is into the next tick (0..1), for interpolating
+ * between the last two simulated states.
+ *
+ * Time is passed in rather than read from a clock, so the same scheduler runs
+ * against wall time (rendered) or any simulated time (headless, faster than real
+ * time), and ticks happen at the same rate whatever the frame rate is.
+ */
+class FixedTimestep
+{
+    double tickLength;
+    int maxTicksPerAdvance;
+
+    bool isStarted = false;
+    double startTime = 0.0;
+    double lastTime = 0.0;
+    unsigned long scheduledTickCount = 0; // ticks due up to lastTime, run or dropped
+
+    // statistics
+    unsigned long tickCount = 0;
+    unsigned long droppedTickCount = 0;
+
+public:
+    FixedTimestep(double tickLength, int maxTicksPerAdvance = 5);
+
+    double getTickLength() const;
+
+    int advance(double time);
+    double getAlpha() const;
+
+    unsigned long getTickCount() const;
+    unsigned long getDroppedTickCount() const;
+};
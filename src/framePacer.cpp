@@ -0,0 +1,164 @@
+#include "framePacer.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+// Waits sleep until this long before the target and spin the rest (seconds)
+#define PACER_SPIN_TIME 0.002
+// A low latency frame starts this long before the tick, to hand it the latest input (seconds)
+#define PACER_TICK_LEAD 0.001
+
+// frameLength: seconds per frame of the capped modes
+FramePacer::FramePacer(double frameLength)
+{
+    this->frameLength = frameLength;
+}
+
+/**
+ * Switches the pacing mode. The swap interval is part of the context state, so
+ * the context must be current.
+ */
+void FramePacer::setMode(PacingMode mode)
+{
+    this->mode = mode;
+    glfwSwapInterval((mode == PacingMode::VSync) ? 1 : 0);
+
+    // measure every mode on its own
+    lastFrameStart = -1.0;
+    frameCount = 0;
+    frameTimeSum = 0.0;
+    frameTimeSquareSum = 0.0;
+    maxFrameTime = 0.0;
+}
+
+PacingMode FramePacer::getMode() const
+{
+    return mode;
+}
+
+const char * FramePacer::getModeName() const
+{
+    switch (mode)
+    {
+        case PacingMode::VSync: return "vsync";
+        case PacingMode::Capped: return "capped";
+        case PacingMode::LowLatency: return "low latency";
+        default: return "uncapped";
+    }
+}
+
+/**
+ * Waits until the next frame should start and records the frame time.
+ * nextTickTime: when the simulation ticks next (seconds), for the low latency mode.
+ */
+void FramePacer::beginFrame(double nextTickTime)
+{
+    if (lastFrameStart >= 0.0)
+    {
+        if (mode == PacingMode::Capped || mode == PacingMode::LowLatency)
+        {
+            lastTarget = getTarget(glfwGetTime(), nextTickTime);
+            waitUntil(lastTarget);
+        }
+    }
+
+    const double now = glfwGetTime();
+    if (lastFrameStart >= 0.0)
+    {
+        const double frameTime = now - lastFrameStart;
+        frameCount++;
+        frameTimeSum += frameTime;
+        frameTimeSquareSum += frameTime * frameTime;
+        maxFrameTime = std::max(maxFrameTime, frameTime);
+    }
+    else
+    {
+        lastTarget = now;
+    }
+    lastFrameStart = now;
+}
+
+/**
+ * Forgets the last frame start: the next frame starts right away and isn't
+ * measured. For when the loop stopped drawing for a while.
+ */
+void FramePacer::restart()
+{
+    lastFrameStart = -1.0;
+}
+
+/**
+ * Start time of the next frame.
+ *
+ * Capped: one frame length after the last target, or now if the loop fell a whole
+ * frame behind (no burst of short frames to catch up).
+ * Low latency: the frame grid is shifted so a frame starts PACER_TICK_LEAD before
+ * the tick. That frame polls the key presses just before the tick samples them,
+ * and the frame after it is the first to show the result.
+ */
+double FramePacer::getTarget(double now, double nextTickTime) const
+{
+    double target = lastTarget + frameLength;
+
+    if (mode == PacingMode::LowLatency)
+    {
+        const double tickFrame = nextTickTime - PACER_TICK_LEAD;
+        if (tickFrame > lastTarget)
+        {
+            // first grid point from now on
+            target = tickFrame - std::floor((tickFrame - now) / frameLength) * frameLength;
+        }
+    }
+
+    if (target < now - frameLength)
+    {
+        target = now;
+    }
+    return target;
+}
+
+void FramePacer::waitUntil(double time)
+{
+    const double sleepTime = time - glfwGetTime() - PACER_SPIN_TIME;
+    if (sleepTime > 0.0)
+    {
+        std::this_thread::sleep_for(std::chrono::duration<double>(sleepTime));
+    }
+
+    while (glfwGetTime() < time)
+    {
+        std::this_thread::yield();
+    }
+}
+
+unsigned long FramePacer::getFrameCount() const
+{
+    return frameCount;
+}
+
+// Average seconds from one frame start to the next
+double FramePacer::getAverageFrameTime() const
+{
+    return (frameCount > 0) ? frameTimeSum / frameCount : 0.0;
+}
+
+// Variance of the frame time (seconds squared)
+double FramePacer::getFrameTimeVariance() const
+{
+    if (frameCount == 0)
+    {
+        return 0.0;
+    }
+
+    const double average = frameTimeSum / frameCount;
+    return std::max(0.0, frameTimeSquareSum / frameCount - average * average);
+}
+
+double FramePacer::getMaxFrameTime() const
+{
+    return maxFrameTime;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+// How the render loop paces its frames
+enum class PacingMode
+{
+    VSync,      // swap waits for the vertical blank
+    Capped,     // fixed frame rate, sleeps then spins to the frame start
+    LowLatency, // capped, with the frame grid aligned to start just before each tick
+    Uncapped    // as fast as possible (for comparison)
+};
+
+/**
+ * Paces the render loop.
+ *
+ * beginFrame() is called at the top of every frame and returns once the frame
+ * should start. Waits sleep until shortly before the target time and spin the
+ * rest, since a plain sleep can overshoot by a millisecond or more. Frame times
+ * (start to start) are measured per mode, for the average, deviation and worst
+ * case.
+ */
+class FramePacer
+{
+    PacingMode mode = PacingMode::VSync;
+    double frameLength;
+    double lastFrameStart = -1.0;
+    double lastTarget = 0.0;
+
+    // statistics of the current mode
+    unsigned long frameCount = 0;
+    double frameTimeSum = 0.0;
+    double frameTimeSquareSum = 0.0;
+    double maxFrameTime = 0.0;
+
+    double getTarget(double now, double nextTickTime) const;
+    void waitUntil(double time);
+
+public:
+    FramePacer(double frameLength);
+
+    void setMode(PacingMode mode);
+    PacingMode getMode() const;
+    const char * getModeName() const;
+
+    void beginFrame(double nextTickTime);
+    void restart();
+
+    unsigned long getFrameCount() const;
+    double getAverageFrameTime() const;
+    double getFrameTimeVariance() const;
+    double getMaxFrameTime() const;
+};
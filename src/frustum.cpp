@@ -0,0 +1,64 @@
+#include "frustum.h"
+
+Frustum::Frustum(const glm::mat4& clip)
+{
+    // Gribb/Hartmann plane extraction, glm matrices are column major
+    const glm::vec4 row0(clip[0][0], clip[1][0], clip[2][0], clip[3][0]);
+    const glm::vec4 row1(clip[0][1], clip[1][1], clip[2][1], clip[3][1]);
+    const glm::vec4 row2(clip[0][2], clip[1][2], clip[2][2], clip[3][2]);
+    const glm::vec4 row3(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+
+    planes[0] = row3 + row0; // left
+    planes[1] = row3 - row0; // right
+    planes[2] = row3 + row1; // bottom
+    planes[3] = row3 - row1; // top
+    planes[4] = row3 + row2; // near
+    planes[5] = row3 - row2; // far
+
+    for (int i = 0; i < 6; i++)
+    {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
+
+/**
+ * Checks if an axis aligned box may be visible.
+ * 
+ * Conservative: boxes near a frustum corner can be reported visible when they are not.
+ */
+bool Frustum::containsBox(const glm::vec3& min, const glm::vec3& max) const
+{
+    for (int i = 0; i < 6; i++)
+    {
+        // corner of the box furthest along the plane normal
+        const glm::vec3 corner
+        (
+            planes[i].x >= 0 ? max.x : min.x,
+            planes[i].y >= 0 ? max.y : min.y,
+            planes[i].z >= 0 ? max.z : min.z
+        );
+
+        if (glm::dot(glm::vec3(planes[i]), corner) + planes[i].w < 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Checks if a sphere may be visible.
+ */
+bool Frustum::containsSphere(const glm::vec3& center, float radius) const
+{
+    for (int i = 0; i < 6; i++)
+    {
+        if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+/**
+ * View frustum as six planes, used to skip geometry that can't be seen.
+ * 
+ * The planes are extracted from a combined clip matrix (projection * view * model),
+ * so they live in the model space of that matrix.
+ */
+class Frustum
+{
+    glm::vec4 planes[6]; // left, right, bottom, top, near, far (inside is positive)
+
+public:
+    Frustum(const glm::mat4& clip);
+    bool containsBox(const glm::vec3& min, const glm::vec3& max) const;
+    bool containsSphere(const glm::vec3& center, float radius) const;
+};
@@ -0,0 +1,204 @@
+#include "gameSimulation.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+
+GameSimulation::GameSimulation(double tickLength) : timestep(tickLength), tickLength(tickLength)
+{
+}
+
+/**
+ * Publishes the initial state and starts the simulation thread.
+ * glfw must be initialized (the thread reads glfwGetTime()).
+ */
+void GameSimulation::start()
+{
+    publish(glfwGetTime());
+
+    isRunning = true;
+    thread = std::thread(&GameSimulation::run, this);
+}
+
+// Stops the simulation thread, waits at most one tick for it to finish.
+void GameSimulation::stop()
+{
+    if (!isRunning)
+    {
+        return;
+    }
+
+    isRunning = false;
+    thread.join();
+}
+
+/**
+ * Hands a direction key press to the simulation thread (render thread).
+ * time: when the press was seen, for the input latency metrics.
+ */
+void GameSimulation::pushTurn(Direction dir, double time)
+{
+    if (!inputEvents.push({dir, time}))
+    {
+        droppedInputs++;
+    }
+}
+
+double GameSimulation::getTickLength() const
+{
+    return tickLength;
+}
+
+/**
+ * Picks up the latest published snapshot (render thread).
+ * Returns true if getSnapshot() changed.
+ */
+bool GameSimulation::update()
+{
+    return snapshots.update();
+}
+
+const GameSnapshot& GameSimulation::getSnapshot() const
+{
+    return snapshots.getFront();
+}
+
+/**
+ * Simulation thread: runs the ticks that are due, publishes the result and
+ * sleeps until the next tick.
+ */
+void GameSimulation::run()
+{
+    timestep.advance(glfwGetTime());
+
+    while (isRunning)
+    {
+        const double now = glfwGetTime();
+        const int ticks = timestep.advance(now);
+
+        if (ticks > 0)
+        {
+            // the latest tick was due alpha ticks ago
+            const double tickTime = now - timestep.getAlpha() * tickLength;
+            const double slip = now - tickTime;
+            slipSum += slip;
+            slipCount++;
+            maxSlip = std::max(maxSlip, slip);
+
+            for (int i = 0; i < ticks; i++)
+            {
+                tick(now);
+            }
+            publish(tickTime);
+
+            maxTickTime = std::max(maxTickTime, glfwGetTime() - now);
+        }
+
+        const double untilNextTick = (1.0 - timestep.getAlpha()) * tickLength;
+        std::this_thread::sleep_for(std::chrono::duration<double>(untilNextTick));
+    }
+}
+
+/**
+ * One fixed simulation step: samples the input, restarts a dead game, otherwise
+ * applies the next queued turn and moves the snake along its heading.
+ * time: when the tick runs (seconds).
+ */
+void GameSimulation::tick(double time)
+{
+    didLastTickMove = false;
+
+    InputEvent event;
+    while (inputEvents.pop(event))
+    {
+        queueTurn(event);
+    }
+
+    if (snakeLogic.isDead())
+    {
+        snakeLogic.reset();
+        heading = -1;
+        queuedTurns = 0;
+        return;
+    }
+
+    if (queuedTurns > 0)
+    {
+        heading = (int) turnQueue[0].dir;
+
+        const double latency = time - turnQueue[0].time;
+        inputLatencySum += latency;
+        maxInputLatency = std::max(maxInputLatency, latency);
+        turns++;
+
+        std::copy(turnQueue + 1, turnQueue + queuedTurns, turnQueue);
+        queuedTurns--;
+    }
+
+    if (heading >= 0)
+    {
+        snakeLogic.move((Direction) heading);
+        didLastTickMove = true;
+    }
+}
+
+/**
+ * Appends a key press to the turn queue. Presses that don't turn the snake
+ * (along or against the heading it will have by then) are ignored; presses that
+ * find the queue full are dropped, the turns queued first win.
+ */
+void GameSimulation::queueTurn(const InputEvent& event)
+{
+    const int last = (queuedTurns > 0) ? (int) turnQueue[queuedTurns - 1].dir : heading;
+
+    // opposite directions only differ in the lowest bit (Up/Down, Right/Left, Forward/Backward)
+    if (last >= 0 && ((int) event.dir | 1) == (last | 1))
+    {
+        return;
+    }
+
+    if (queuedTurns == MAX_QUEUED_TURNS)
+    {
+        droppedTurns++;
+        return;
+    }
+
+    turnQueue[queuedTurns++] = event;
+}
+
+// Copies the game state into the back snapshot and hands it to the render thread.
+void GameSimulation::publish(double tickTime)
+{
+    GameSnapshot& snapshot = snapshots.getBack();
+
+    snapshot.snakeSize = snakeLogic.getSnakeSize();
+    std::copy(snakeLogic.getSnake(), snakeLogic.getSnake() + snapshot.snakeSize, snapshot.snake);
+    snapshot.applesSize = snakeLogic.getApplesSize();
+    std::copy(snakeLogic.getApples(), snakeLogic.getApples() + snapshot.applesSize, snapshot.apples);
+
+    snapshot.generation = snakeLogic.getGeneration();
+    snapshot.change = snakeLogic.getLastChange();
+    snapshot.didMove = didLastTickMove;
+    snapshot.tick = timestep.getTickCount();
+    snapshot.tickTime = tickTime;
+
+    snapshot.maxSlip = maxSlip;
+    snapshot.averageSlip = (slipCount > 0) ? slipSum / slipCount : 0.0;
+    snapshot.maxTickTime = maxTickTime;
+    snapshot.droppedTicks = timestep.getDroppedTickCount();
+    snapshot.overwrittenSnapshots = overwrittenSnapshots;
+    snapshot.turns = turns;
+    snapshot.droppedTurns = droppedTurns + droppedInputs;
+    snapshot.maxInputLatency = maxInputLatency;
+    snapshot.averageInputLatency = (turns > 0) ? inputLatencySum / turns : 0.0;
+
+    snapshot.publishTime = glfwGetTime();
+    if (!snapshots.publish())
+    {
+        overwrittenSnapshots++;
+    }
+
+    // wake the render thread if it waits for events
+    glfwPostEmptyEvent();
+}
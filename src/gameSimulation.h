@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "fixedTimestep.h"
+#include "snakeLogic.h"
+#include "spscRing.h"
+#include "tripleBuffer.h"
+
+// Turns waiting for the ticks that apply them. A quick second key press before
+// the next tick is applied one tick later instead of replacing the first.
+#define MAX_QUEUED_TURNS 2
+#define INPUT_RING_SIZE 16
+
+// A direction key press, stamped with when the render thread saw it (seconds).
+struct InputEvent
+{
+    Direction dir;
+    double time;
+};
+
+// Immutable copy of the game state after a tick, handed from the simulation
+// thread to the render thread.
+struct GameSnapshot
+{
+    SnakePart snake[MAX_SNAKE_SIZE];
+    int snakeSize = 0;
+    Apple apples[MAX_APPLES];
+    int applesSize = 0;
+
+    unsigned int generation = 0; // SnakeLogic::getGeneration()
+    SnakeChange change;          // SnakeLogic::getLastChange()
+    bool didMove = false;        // the last tick moved the snake
+    unsigned long tick = 0;      // ticks simulated so far
+    double tickTime = 0.0;       // when the last tick was due (seconds)
+    double publishTime = 0.0;    // when this snapshot was published (seconds)
+
+    // simulation thread metrics
+    double maxSlip = 0.0;        // longest a tick ran after it was due (seconds)
+    double averageSlip = 0.0;
+    double maxTickTime = 0.0;    // longest tick batch including the snapshot copy (seconds)
+    unsigned long droppedTicks = 0;
+    unsigned long overwrittenSnapshots = 0; // published, but replaced before the render thread picked them up
+    unsigned long turns = 0;         // queued turns applied by a tick
+    unsigned long droppedTurns = 0;  // turns dropped because the queue or ring was full
+    double maxInputLatency = 0.0;    // longest from key press to the tick applying it (seconds)
+    double averageInputLatency = 0.0;
+};
+
+/**
+ * Runs SnakeLogic on its own thread at a fixed tick rate.
+ *
+ * After every batch of ticks the thread publishes a GameSnapshot through a
+ * lock-free triple buffer, so neither a slow frame nor a slow tick ever delays
+ * the other thread. Every publish posts an empty glfw event, to wake a render
+ * thread that waits for events. The render thread only talks to the simulation
+ * through pushTurn() and update()/getSnapshot().
+ *
+ * Key presses reach the simulation thread through a lock-free ring of
+ * timestamped InputEvents. Each tick drains the ring into a short turn queue and
+ * applies at most one queued turn, so turns pressed in quick succession between
+ * two ticks each get their own tick. The snake moves one cell per tick along its
+ * heading. After a reset it waits for the next turn.
+ */
+class GameSimulation
+{
+    // simulation thread only
+    SnakeLogic snakeLogic;
+    FixedTimestep timestep;
+    bool didLastTickMove = false;
+    int heading = -1; // Direction, -1 while there is none
+    InputEvent turnQueue[MAX_QUEUED_TURNS];
+    int queuedTurns = 0;
+    unsigned long turns = 0;
+    unsigned long droppedTurns = 0;
+    double inputLatencySum = 0.0;
+    double maxInputLatency = 0.0;
+    double slipSum = 0.0;
+    unsigned long slipCount = 0;
+    double maxSlip = 0.0;
+    double maxTickTime = 0.0;
+    unsigned long overwrittenSnapshots = 0;
+
+    const double tickLength;
+    TripleBuffer<GameSnapshot> snapshots;
+    std::thread thread;
+    std::atomic<bool> isRunning{false};
+    SpscRing<InputEvent, INPUT_RING_SIZE> inputEvents;
+    std::atomic<unsigned long> droppedInputs{0}; // presses that found the ring full
+
+    void run();
+    void tick(double time);
+    void queueTurn(const InputEvent& event);
+    void publish(double tickTime);
+
+public:
+    GameSimulation(double tickLength);
+
+    void start();
+    void stop();
+
+    void pushTurn(Direction dir, double time);
+    double getTickLength() const;
+
+    bool update();
+    const GameSnapshot& getSnapshot() const;
+};
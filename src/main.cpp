@@ -5,65 +5,222 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <utility>
+#include <vector>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-#include "snakeLogic.h"
+#include "cameraBuffer.h"
+#include "cubeGeometry.h"
+#include "framePacer.h"
+#include "frustum.h"
+#include "gameSimulation.h"
+#include "redrawTracker.h"
+#include "renderQueue.h"
+#include "shaderProgram.h"
+#include "streamBuffer.h"
+#include "terrain.h"
+#include "textureAtlas.h"
 
 // Screen dimensions
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
-unsigned int shaderProgram;
-unsigned int shaderProgramBG;
+ShaderProgram terrainProgram;
+ShaderProgram instancedProgram;
+ShaderProgram backgroundProgram;
 unsigned int textureAtlas;
-unsigned int dirtBlockVAO;
-unsigned int wormBodyVAO;
-unsigned int appleVAO;
-unsigned int wormHeadVAO;
-unsigned int dirtWithGrassVAO;
+unsigned int cubeVAO;
+CubeVariantRange cubeVariants[CUBE_VARIANT_COUNT];
+unsigned int terrainVAO;
+std::vector<TerrainChunk> terrainChunks;
+std::vector<unsigned int> terrainChunkOrder; // selected chunk indices, nearest to the camera first
+
+// A terrain chunk is drawn whole once it projects smaller than this (pixels across).
+// Coarse chunks look the same as their children, but larger ones are split so
+// frustum culling can drop the parts that are off screen.
+const float TERRAIN_LOD_PIXELS = 1.5f * SCR_HEIGHT;
 unsigned int bgVAO;
 
-GLFWwindow* window;
+// Cube entity types, used by the instanced shader
+#define CUBE_TYPE_WORM_BODY 0
+#define CUBE_TYPE_APPLE 1
+
+#define STR_(x) #x
+#define STR(x) STR_(x)
+
+// Per-instance data of a cube entity
+struct CubeInstance
+{
+    float x, y, z;
+    float fromX, fromY, fromZ; // cell the entity slides from during a tick
+    int dir;  // Direction
+    int type; // CUBE_TYPE_*
+};
+
+// Instance buffer layout: a ring of snake slots, followed by the apples
+const unsigned int SNAKE_FIRST_INSTANCE = 0;
+const unsigned int APPLE_FIRST_INSTANCE = MAX_SNAKE_SIZE;
+const unsigned int INSTANCE_CAPACITY = MAX_SNAKE_SIZE + MAX_APPLES;
+
+// Entity instances only change with the game state (see SnakeLogic::getGeneration),
+// so they live in a static buffer that is patched in place.
+// Snake part i is in slot (snakeHeadSlot + i) % MAX_SNAKE_SIZE: a move writes the
+// new head into the slot before the old head, instead of shifting every part.
+unsigned int instanceVBO;
+unsigned int snakeHeadSlot = 0;
+unsigned int instanceGeneration = 0;
+bool areInstancesValid = false;
+int instanceUploadCount = 0;      // frames that patched the instance buffer
+int instanceWriteCount = 0;       // instances written by them
+
+// How the scene is submitted: one draw call per entity class / chunk batch (3.3),
+// or the whole frame from a draw command buffer in two indirect calls (4.3).
+enum class RenderMode
+{
+    Direct, Indirect
+};
+
+RenderMode renderMode = RenderMode::Direct;
+bool isIndirectSupported = false;
 
-SnakeLogic snakeLogic;
+// Layouts of glMultiDrawArraysIndirect and glMultiDrawElementsIndirect commands
+struct DrawArraysIndirectCommand
+{
+    unsigned int count;
+    unsigned int instanceCount;
+    unsigned int first;
+    unsigned int baseInstance;
+};
+
+struct DrawElementsIndirectCommand
+{
+    unsigned int count;
+    unsigned int instanceCount;
+    unsigned int firstIndex;
+    int baseVertex;
+    unsigned int baseInstance;
+};
+
+// Draw commands of the current frame (terrain chunks, entity classes)
+std::vector<DrawArraysIndirectCommand> terrainCommands;
+std::vector<unsigned int> terrainCommandDepths; // depth rank of each terrain command
+std::vector<DrawElementsIndirectCommand> entityCommands;
+StreamBuffer commandStream;
+
+// The frame's draws, sorted by state before they are issued
+RenderQueue renderQueue;
+
+// Uniform locations, resolved once after linking
+int instancedTimeLocation;
+int instancedTickPhaseLocation;
+
+// Camera, shared by all programs through the Camera uniform block
+CameraBuffer cameraBuffer;
+glm::mat4 projection;
+glm::mat4 view;
+glm::mat4 parent;
+
+GLFWwindow* window;
 
-const double MOVE_INTERVAL = 0.4f; // seconds
-double lastMoveTime = 0.f; // seconds
+// Simulation, on its own thread: the snake moves one cell per tick, heading where
+// the keys last pointed. The renderer draws the latest snapshot it published.
+constexpr double MOVE_INTERVAL = 0.4; // seconds per tick
+// FixedTimestep counts due ticks as floor(elapsed / tickLength): a headless 400 s
+// run has to give exactly 1000 ticks (a float literal here gives 999)
+static_assert((long) (400.0 / MOVE_INTERVAL) == 1000, "MOVE_INTERVAL must divide 400 s into 1000 ticks");
+GameSimulation gameSimulation(MOVE_INTERVAL);
+const GameSnapshot * game = NULL;
+float tickPhase = 1.0f; // 0..1 into the tick after a move, for the slide animation
+
+// Snake turn keys, handed to the simulation as they are pressed (see keyCallback)
+const int DIRECTION_KEYS[6] = {GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_D, GLFW_KEY_A, GLFW_KEY_Q, GLFW_KEY_E};
+const Direction DIRECTIONS[6] = {Direction::Up, Direction::Down, Direction::Right, Direction::Left, Direction::Forward, Direction::Backward};
+
+// Render thread side of the snapshot handoff
+double maxSnapshotLatency = 0.0;  // longest from publish to pick up (seconds)
+double snapshotLatencySum = 0.0;
+unsigned long snapshotCount = 0;  // snapshots picked up
+
+// Frame pacing, V cycles through the modes
+#define FRAME_RATE_CAP 60.0 // frames per second of the capped modes
+FramePacer framePacer(1.0 / FRAME_RATE_CAP);
+
+// Render on demand (R toggles): frames that would look like the last one are
+// skipped, and the loop sleeps until something changes. Animations are stepped
+// so that the game idles in between.
+bool isRenderOnDemand = false;
+RedrawTracker redrawTracker;
+#define ON_DEMAND_SLIDE_TIME 0.1 // seconds the slide after a move takes
+#define ON_DEMAND_SPIN_STEP 0.1  // seconds per apple rotation step
 
 const double DEBUG_TOGGLE_INTERVAL = 0.4f; // seconds
 double lastDebugToggleTime = 0.f; // seconds
 bool isWireFrameModeOn = false;
 
-// apple rotation
-const double APPLE_ROTATION_INTERVAL = 0.01; // seconds
-double lastAppleRotationTime = 0.0f; // seconds
-float appleRotationAngel = 0; // degrees
+// apple rotation, animated by the instanced shader
+#define APPLE_SPIN_SPEED 100.0 // degrees per second
+double animationTime = 0.0; // seconds, the time the apples are drawn at
 
 // Rotation angels for cube (degrees)
 float xAngel = 0; // rotation about x axis (up/down)
 float yAngel = 0; // rotation about y axis (left/right)
 
+/**
+ * Loads the texture atlas as a texture array, one layer per tile, with per-layer
+ * mip chains built on the CPU.
+ * 
+ * Layers wrap on their own, so merged terrain faces repeat their tile with GL_REPEAT
+ * and mip levels never mix neighbouring tiles. Sampled nearest within a level and
+ * linear between levels: the blocks keep their pixel look up close, and distant
+ * blocks read small levels instead of shimmering.
+ */
 void loadTextureAtlas()
 {
     glGenTextures(1, &textureAtlas);
-    glBindTexture(GL_TEXTURE_2D, textureAtlas);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureAtlas);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
     stbi_set_flip_vertically_on_load(true); 
 
     int width, height, nrChannels;
-    unsigned char *data = stbi_load("Snake3DTextureAtlas.png", &width, &height, &nrChannels, 0);
+    unsigned char *data = stbi_load("Snake3DTextureAtlas.png", &width, &height, &nrChannels, 4);
     if (data)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        std::vector<AtlasImage> tiles;
+        sliceAtlasTiles(data, width, height, tiles);
+
+        const int levelCount = getAtlasMipLevelCount(tiles[0]);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        for (int level = 0; level < levelCount; level++)
+        {
+            if (level > 0)
+            {
+                for (AtlasImage& tile : tiles)
+                {
+                    AtlasImage source = std::move(tile);
+                    downsampleAtlas(source, tile);
+                }
+            }
+
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, tiles[0].width, tiles[0].height, ATLAS_LAYER_COUNT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            for (int layer = 0; layer < ATLAS_LAYER_COUNT; layer++)
+            {
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, tiles[layer].width, tiles[layer].height, 1, GL_RGBA, GL_UNSIGNED_BYTE, tiles[layer].pixels.data());
+            }
+        }
     }
     else
     {
@@ -72,23 +229,64 @@ void loadTextureAtlas()
     stbi_image_free(data);
 }
 
+/**
+ * Queues a turn for every direction key press, stamped with when it was seen.
+ * Presses between two ticks all reach the simulation, however short they are.
+ */
+void keyCallback(GLFWwindow * window, int key, int scancode, int action, int mods)
+{
+    if (action != GLFW_PRESS)
+    {
+        return;
+    }
+
+    for (int i = 0; i < 6; i++)
+    {
+        if (key == DIRECTION_KEYS[i])
+        {
+            gameSimulation.pushTurn(DIRECTIONS[i], glfwGetTime());
+            return;
+        }
+    }
+}
+
+// The window was damaged or resized, its contents must be drawn again.
+void windowRefreshCallback(GLFWwindow * window)
+{
+    redrawTracker.markDirty(REDRAW_WINDOW);
+}
+
+void framebufferSizeCallback(GLFWwindow * window, int width, int height)
+{
+    redrawTracker.markDirty(REDRAW_WINDOW);
+}
+
 bool init()
 {
     // initialize glfw
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    // create window 
+    // create window, prefer 4.3 (indirect drawing) and fall back to 3.3
     window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Snake3D", NULL, NULL);
     if (window == NULL)
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Snake3D", NULL, NULL);
+    }
+    if (window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
         return false;
     }
     glfwMakeContextCurrent(window);
+    glfwSetKeyCallback(window, keyCallback);
+    glfwSetWindowRefreshCallback(window, windowRefreshCallback);
+    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
     // load opengl functions
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
@@ -100,810 +298,207 @@ bool init()
     // initial viewport
     glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
 
-    return true;
-}
+    framePacer.setMode(PacingMode::VSync);
 
-void makeDirtWithGrassVAO()
-{
-    const float position[] = 
-    {
-        // Front face
-        // A, C, B
-        -0.5f,  0.5f,  0.5f,
-        -0.5f, -0.5f,  0.5f,
-        0.5f,  0.5f,  0.5f,
-        // D, B, C
-        0.5f, -0.5f,  0.5f,
-        0.5f,  0.5f,  0.5f,
-        -0.5f, -0.5f,  0.5f,
-
-        // Back face
-        // E, F, G
-        -0.5f,  0.5f, -0.5f,
-        0.5f,  0.5f, -0.5f,
-        -0.5f, -0.5f, -0.5f,
-        // H, G, F
-        0.5f, -0.5f, -0.5f,
-        -0.5f, -0.5f, -0.5f,
-        0.5f,  0.5f, -0.5f,
-
-        // Top face
-        // E, A, F
-        -0.5f,  0.5f, -0.5f,
-        -0.5f,  0.5f,  0.5f,
-        0.5f,  0.5f, -0.5f,
-        // B, F, A
-        0.5f,  0.5f,  0.5f,
-        0.5f,  0.5f, -0.5f,
-        -0.5f,  0.5f,  0.5f,
-
-        // Left face
-        // A, E, C
-        -0.5f,  0.5f,  0.5f,
-        -0.5f,  0.5f, -0.5f,
-        -0.5f, -0.5f,  0.5f,
-        // G, C, E
-        -0.5f, -0.5f, -0.5f,
-        -0.5f, -0.5f,  0.5f,
-        -0.5f,  0.5f, -0.5f,
-
-        // Right face
-        // B, D, F
-        0.5f,  0.5f,  0.5f,
-        0.5f, -0.5f,  0.5f,
-        0.5f,  0.5f, -0.5f,
-        // H, F, D
-        0.5f, -0.5f, -0.5f,
-        0.5f,  0.5f, -0.5f,
-        0.5f, -0.5f,  0.5f,
-
-        // Bottom face
-        // G, H, C
-        -0.5f, -0.5f, -0.5f,
-        0.5f, -0.5f, -0.5f,
-        -0.5f, -0.5f,  0.5f,
-        // D, C, H
-        0.5f, -0.5f,  0.5f,
-        -0.5f, -0.5f,  0.5f,
-        0.5f, -0.5f, -0.5f
-    };
-
-    const float texCoords[] = 
-    {
-        // Front face
-        // A, C, B
-        0.0f/4.0f, 4.0f/6.0f,
-        0.0f/4.0f, 3.0f/6.0f,
-        1.0f/4.0f, 4.0f/6.0f,
-        // D, B, C
-        1.0f/4.0f, 3.0f/6.0f,
-        1.0f/4.0f, 4.0f/6.0f,
-        0.0f/4.0f, 3.0f/6.0f,
-
-        // Back face
-        // E, F, G
-        1.0f/4.0f, 4.0f/6.0f,
-        0.0f/4.0f, 4.0f/6.0f,
-        1.0f/4.0f, 3.0f/6.0f,
-        // H, G, F
-        0.0f/4.0f, 3.0f/6.0f,
-        1.0f/4.0f, 3.0f/6.0f,
-        0.0f/4.0f, 4.0f/6.0f,
-
-        // Top face
-        // E, A, F
-        1.0f/4.0f, 4.0f/6.0f,
-        1.0f/4.0f, 3.0f/6.0f,
-        2.0f/4.0f, 4.0f/6.0f,
-        // B, F, A
-        2.0f/4.0f, 3.0f/6.0f,
-        2.0f/4.0f, 4.0f/6.0f,
-        1.0f/4.0f, 3.0f/6.0f,
-
-        // Left face
-        // A, E, C
-        1.0f/4.0f, 4.0f/6.0f,
-        0.0f/4.0f, 4.0f/6.0f,
-        1.0f/4.0f, 3.0f/6.0f,
-        // G, C, E
-        0.0f/4.0f, 3.0f/6.0f,
-        1.0f/4.0f, 3.0f/6.0f,
-        0.0f/4.0f, 4.0f/6.0f,
-
-        // Right face
-        // B, D, F
-        0.0f/4.0f, 4.0f/6.0f,
-        0.0f/4.0f, 3.0f/6.0f,
-        1.0f/4.0f, 4.0f/6.0f,
-        // H, F, D
-        1.0f/4.0f, 3.0f/6.0f,
-        1.0f/4.0f, 4.0f/6.0f,
-        0.0f/4.0f, 3.0f/6.0f,
-
-        // Bottom face
-        // G, H, C
-        2.0f/4.0f, 4.0f/6.0f,
-        3.0f/4.0f, 4.0f/6.0f,
-        2.0f/4.0f, 3.0f/6.0f,
-        // D, C, H
-        3.0f/4.0f, 3.0f/6.0f,
-        2.0f/4.0f, 3.0f/6.0f,
-        3.0f/4.0f, 4.0f/6.0f,
-    };
-
-    unsigned int VBO_position, VBO_texCoords;
-
-    glGenVertexArrays(1, &dirtWithGrassVAO);
-    glBindVertexArray(dirtWithGrassVAO);
-
-    glGenBuffers(1, &VBO_position);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_position);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(position), position, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0,3,GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
-    glEnableVertexAttribArray(0);
+    // multi draw indirect and base instance are core since 4.3
+    isIndirectSupported = GLAD_GL_VERSION_4_3;
+    renderMode = isIndirectSupported ? RenderMode::Indirect : RenderMode::Direct;
 
-    glGenBuffers(1, &VBO_texCoords);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_texCoords);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(texCoords), texCoords, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 & sizeof(float), 0);
-    glEnableVertexAttribArray(1);
+    return true;
 }
 
-void makeAppleVAO()
+void makeInstanceVBO()
 {
-    const float position[] = 
-    {
-        // Front face
-        // A, C, B
-        -0.5f,  0.5f,  0.5f,
-        -0.5f, -0.5f,  0.5f,
-        0.5f,  0.5f,  0.5f,
-        // D, B, C
-        0.5f, -0.5f,  0.5f,
-        0.5f,  0.5f,  0.5f,
-        -0.5f, -0.5f,  0.5f,
-
-        // Back face
-        // E, F, G
-        -0.5f,  0.5f, -0.5f,
-        0.5f,  0.5f, -0.5f,
-        -0.5f, -0.5f, -0.5f,
-        // H, G, F
-        0.5f, -0.5f, -0.5f,
-        -0.5f, -0.5f, -0.5f,
-        0.5f,  0.5f, -0.5f,
-
-        // Top face
-        // E, A, F
-        -0.5f,  0.5f, -0.5f,
-        -0.5f,  0.5f,  0.5f,
-        0.5f,  0.5f, -0.5f,
-        // B, F, A
-        0.5f,  0.5f,  0.5f,
-        0.5f,  0.5f, -0.5f,
-        -0.5f,  0.5f,  0.5f,
-
-        // Left face
-        // A, E, C
-        -0.5f,  0.5f,  0.5f,
-        -0.5f,  0.5f, -0.5f,
-        -0.5f, -0.5f,  0.5f,
-        // G, C, E
-        -0.5f, -0.5f, -0.5f,
-        -0.5f, -0.5f,  0.5f,
-        -0.5f,  0.5f, -0.5f,
-
-        // Right face
-        // B, D, F
-        0.5f,  0.5f,  0.5f,
-        0.5f, -0.5f,  0.5f,
-        0.5f,  0.5f, -0.5f,
-        // H, F, D
-        0.5f, -0.5f, -0.5f,
-        0.5f,  0.5f, -0.5f,
-        0.5f, -0.5f,  0.5f,
-
-        // Bottom face
-        // G, H, C
-        -0.5f, -0.5f, -0.5f,
-        0.5f, -0.5f, -0.5f,
-        -0.5f, -0.5f,  0.5f,
-        // D, C, H
-        0.5f, -0.5f,  0.5f,
-        -0.5f, -0.5f,  0.5f,
-        0.5f, -0.5f, -0.5f
-    };
-
-    const float texCoords[] = 
-    {
-        // Front face
-        // A, C, B
-        3.0f/4.0f, 5.0f/6.0f,
-        3.0f/4.0f, 4.0f/6.0f,
-        4.0f/4.0f, 5.0f/6.0f,
-        // D, B, C
-        4.0f/4.0f, 4.0f/6.0f,
-        4.0f/4.0f, 5.0f/6.0f,
-        3.0f/4.0f, 4.0f/6.0f,
-
-        // Back face
-        // E, F, G
-        2.0f/4.0f, 5.0f/6.0f,
-        1.0f/4.0f, 5.0f/6.0f,
-        2.0f/4.0f, 4.0f/6.0f,
-        // H, G, F
-        1.0f/4.0f, 4.0f/6.0f,
-        2.0f/4.0f, 4.0f/6.0f,
-        1.0f/4.0f, 5.0f/6.0f,
-
-        // Top face
-        // E, A, F
-        1.0f/4.0f, 5.0f/6.0f,
-        1.0f/4.0f, 4.0f/6.0f,
-        2.0f/4.0f, 5.0f/6.0f,
-        // B, F, A
-        2.0f/4.0f, 4.0f/6.0f,
-        2.0f/4.0f, 5.0f/6.0f,
-        1.0f/4.0f, 4.0f/6.0f,
-
-        // Left face
-        // A, E, C
-        3.0f/4.0f, 5.0f/6.0f,
-        2.0f/4.0f, 5.0f/6.0f,
-        3.0f/4.0f, 4.0f/6.0f,
-        // G, C, E
-        2.0f/4.0f, 4.0f/6.0f,
-        3.0f/4.0f, 4.0f/6.0f,
-        2.0f/4.0f, 5.0f/6.0f,
-
-        // Right face
-        // B, D, F
-        4.0f/4.0f, 4.0f/6.0f,
-        4.0f/4.0f, 5.0f/6.0f,
-        3.0f/4.0f, 4.0f/6.0f,
-        // H, F, D
-        3.0f/4.0f, 5.0f/6.0f,
-        3.0f/4.0f, 4.0f/6.0f,
-        4.0f/4.0f, 5.0f/6.0f,
-
-        // Bottom face
-        // G, H, C
-        1.0f/4.0f, 4.0f/6.0f,
-        2.0f/4.0f, 4.0f/6.0f,
-        1.0f/4.0f, 5.0f/6.0f,
-        // D, C, H
-        2.0f/4.0f, 5.0f/6.0f,
-        1.0f/4.0f, 5.0f/6.0f,
-        2.0f/4.0f, 4.0f/6.0f,
-    };
-
-    unsigned int VBO_position, VBO_texCoords;
-
-    glGenVertexArrays(1, &appleVAO);
-    glBindVertexArray(appleVAO);
-
-    glGenBuffers(1, &VBO_position);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_position);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(position), position, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0,3,GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
-    glEnableVertexAttribArray(0);
-
-    glGenBuffers(1, &VBO_texCoords);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_texCoords);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(texCoords), texCoords, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 & sizeof(float), 0);
-    glEnableVertexAttribArray(1);
+    glGenBuffers(1, &instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, INSTANCE_CAPACITY * sizeof(CubeInstance), NULL, GL_DYNAMIC_DRAW);
 }
 
-void makeWormBodyVAO()
+/**
+ * Points the per-instance attributes (offset, slide origin, direction, type) of the bound VAO
+ * at the instance buffer, starting at instance firstInstance.
+ * 
+ * Used to select the instance range of an entity class before drawing it
+ * from the shared cube VAO.
+ */
+void setInstanceAttributes(unsigned int firstInstance)
 {
-    const float position[] = 
-    {
-        // Back face
-        // E, F, G
-        -0.5f,  0.5f, -0.5f,
-        0.5f,  0.5f, -0.5f,
-        -0.5f, -0.5f, -0.5f,
-        // H, G, F
-        0.5f, -0.5f, -0.5f,
-        -0.5f, -0.5f, -0.5f,
-        0.5f,  0.5f, -0.5f,
-
-        // Top face
-        // E, A, F
-        -0.5f,  0.5f, -0.5f,
-        -0.5f,  0.5f,  0.5f,
-        0.5f,  0.5f, -0.5f,
-        // B, F, A
-        0.5f,  0.5f,  0.5f,
-        0.5f,  0.5f, -0.5f,
-        -0.5f,  0.5f,  0.5f,
-
-        // Left face
-        // A, E, C
-        -0.5f,  0.5f,  0.5f,
-        -0.5f,  0.5f, -0.5f,
-        -0.5f, -0.5f,  0.5f,
-        // G, C, E
-        -0.5f, -0.5f, -0.5f,
-        -0.5f, -0.5f,  0.5f,
-        -0.5f,  0.5f, -0.5f,
-
-        // Right face
-        // B, D, F
-        0.5f,  0.5f,  0.5f,
-        0.5f, -0.5f,  0.5f,
-        0.5f,  0.5f, -0.5f,
-        // H, F, D
-        0.5f, -0.5f, -0.5f,
-        0.5f,  0.5f, -0.5f,
-        0.5f, -0.5f,  0.5f,
-
-        // Bottom face
-        // G, H, C
-        -0.5f, -0.5f, -0.5f,
-        0.5f, -0.5f, -0.5f,
-        -0.5f, -0.5f,  0.5f,
-        // D, C, H
-        0.5f, -0.5f,  0.5f,
-        -0.5f, -0.5f,  0.5f,
-        0.5f, -0.5f, -0.5f
-    };
+    const size_t base = firstInstance * sizeof(CubeInstance);
 
-    const float texCoords[] = 
-    {
-        // Back face
-        // E, F, G
-        1.0f/4.0f, 5.0f/6.0f,
-        0.0f/4.0f, 5.0f/6.0f,
-        1.0f/4.0f, 4.0f/6.0f,
-        // H, G, F
-        0.0f/4.0f, 4.0f/6.0f,
-        1.0f/4.0f, 4.0f/6.0f,
-        0.0f/4.0f, 5.0f/6.0f,
-
-        // Top face
-        // E, A, F
-        4.0f/4.0f, 5.0f/6.0f,
-        4.0f/4.0f, 6.0f/6.0f,
-        3.0f/4.0f, 5.0f/6.0f,
-        // B, F, A
-        3.0f/4.0f, 6.0f/6.0f,
-        3.0f/4.0f, 5.0f/6.0f,
-        4.0f/4.0f, 6.0f/6.0f,
-
-        // Left face
-        // A, E, C
-        3.0f/4.0f, 6.0f/6.0f,
-        3.0f/4.0f, 5.0f/6.0f,
-        4.0f/4.0f, 6.0f/6.0f,
-        // G, C, E
-        4.0f/4.0f, 5.0f/6.0f,
-        4.0f/4.0f, 6.0f/6.0f,
-        3.0f/4.0f, 5.0f/6.0f,
-
-        // Right face
-        // B, D, F
-        4.0f/4.0f, 6.0f/6.0f,
-        3.0f/4.0f, 6.0f/6.0f,
-        4.0f/4.0f, 5.0f/6.0f,
-        // H, F, D
-        3.0f/4.0f, 5.0f/6.0f,
-        4.0f/4.0f, 5.0f/6.0f,
-        3.0f/4.0f, 6.0f/6.0f,
-
-        // Bottom face
-        // G, H, C
-        3.0f/4.0f, 5.0f/6.0f,
-        4.0f/4.0f, 5.0f/6.0f,
-        3.0f/4.0f, 6.0f/6.0f,
-        // D, C, H
-        4.0f/4.0f, 6.0f/6.0f,
-        3.0f/4.0f, 6.0f/6.0f,
-        4.0f/4.0f, 5.0f/6.0f,
-    };
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
 
-    unsigned int VBO_position, VBO_texCoords;
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(CubeInstance), (void *) (base + offsetof(CubeInstance, x)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
 
-    glGenVertexArrays(1, &wormBodyVAO);
-    glBindVertexArray(wormBodyVAO);
+    glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(CubeInstance), (void *) (base + offsetof(CubeInstance, fromX)));
+    glEnableVertexAttribArray(5);
+    glVertexAttribDivisor(5, 1);
 
-    glGenBuffers(1, &VBO_position);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_position);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(position), position, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0,3,GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
-    glEnableVertexAttribArray(0);
+    glVertexAttribIPointer(3, 1, GL_INT, sizeof(CubeInstance), (void *) (base + offsetof(CubeInstance, dir)));
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
 
-    glGenBuffers(1, &VBO_texCoords);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_texCoords);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(texCoords), texCoords, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 & sizeof(float), 0);
-    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(4, 1, GL_INT, sizeof(CubeInstance), (void *) (base + offsetof(CubeInstance, type)));
+    glEnableVertexAttribArray(4);
+    glVertexAttribDivisor(4, 1);
 }
 
-void makeWormHeadVAO()
+void makeCubeVAO()
 {
-    const float position[] = 
-    {
-        // Front face
-        // A, C, B
-        -0.5f,  0.5f,  0.5f,
-        -0.5f, -0.5f,  0.5f,
-        0.5f,  0.5f,  0.5f,
-        // D, B, C
-        0.5f, -0.5f,  0.5f,
-        0.5f,  0.5f,  0.5f,
-        -0.5f, -0.5f,  0.5f,
-
-        // Back face
-        // E, F, G
-        -0.5f,  0.5f, -0.5f,
-        0.5f,  0.5f, -0.5f,
-        -0.5f, -0.5f, -0.5f,
-        // H, G, F
-        0.5f, -0.5f, -0.5f,
-        -0.5f, -0.5f, -0.5f,
-        0.5f,  0.5f, -0.5f,
-
-        // Top face
-        // E, A, F
-        -0.5f,  0.5f, -0.5f,
-        -0.5f,  0.5f,  0.5f,
-        0.5f,  0.5f, -0.5f,
-        // B, F, A
-        0.5f,  0.5f,  0.5f,
-        0.5f,  0.5f, -0.5f,
-        -0.5f,  0.5f,  0.5f,
-
-        // Left face
-        // A, E, C
-        -0.5f,  0.5f,  0.5f,
-        -0.5f,  0.5f, -0.5f,
-        -0.5f, -0.5f,  0.5f,
-        // G, C, E
-        -0.5f, -0.5f, -0.5f,
-        -0.5f, -0.5f,  0.5f,
-        -0.5f,  0.5f, -0.5f,
-
-        // Right face
-        // B, D, F
-        0.5f,  0.5f,  0.5f,
-        0.5f, -0.5f,  0.5f,
-        0.5f,  0.5f, -0.5f,
-        // H, F, D
-        0.5f, -0.5f, -0.5f,
-        0.5f,  0.5f, -0.5f,
-        0.5f, -0.5f,  0.5f,
-
-        // Bottom face
-        // G, H, C
-        -0.5f, -0.5f, -0.5f,
-        0.5f, -0.5f, -0.5f,
-        -0.5f, -0.5f,  0.5f,
-        // D, C, H
-        0.5f, -0.5f,  0.5f,
-        -0.5f, -0.5f,  0.5f,
-        0.5f, -0.5f, -0.5f
-    };
+    std::vector<CubeVertex> vertices;
+    std::vector<unsigned char> indices;
+    buildCubeGeometry(vertices, indices, cubeVariants);
 
-    const float texCoords[] = 
-    {
-        // Front face
-        // A, C, B
-        0.0f/4.0f, 6.0f/6.0f,
-        0.0f/4.0f, 5.0f/6.0f,
-        1.0f/4.0f, 6.0f/6.0f,
-        // D, B, C
-        1.0f/4.0f, 5.0f/6.0f,
-        1.0f/4.0f, 6.0f/6.0f,
-        0.0f/4.0f, 5.0f/6.0f,
-
-        // Back face
-        // E, F, G
-        1.0f/4.0f, 3.0f/6.0f,
-        0.0f/4.0f, 3.0f/6.0f,
-        1.0f/4.0f, 2.0f/6.0f,
-        // H, G, F
-        0.0f/4.0f, 2.0f/6.0f,
-        1.0f/4.0f, 2.0f/6.0f,
-        0.0f/4.0f, 3.0f/6.0f,
-
-        // Top face
-        // E, A, F
-        3.0f/4.0f, 5.0f/6.0f,
-        3.0f/4.0f, 6.0f/6.0f,
-        2.0f/4.0f, 5.0f/6.0f,
-        // B, F, A
-        2.0f/4.0f, 6.0f/6.0f,
-        2.0f/4.0f, 5.0f/6.0f,
-        3.0f/4.0f, 6.0f/6.0f,
-
-        // Left face
-        // A, E, C
-        2.0f/4.0f, 6.0f/6.0f,
-        2.0f/4.0f, 5.0f/6.0f,
-        1.0f/4.0f, 6.0f/6.0f,
-        // G, C, E
-        1.0f/4.0f, 5.0f/6.0f,
-        1.0f/4.0f, 6.0f/6.0f,
-        2.0f/4.0f, 5.0f/6.0f,
-
-        // Right face
-        // B, D, F
-        2.0f/4.0f, 6.0f/6.0f,
-        1.0f/4.0f, 6.0f/6.0f,
-        2.0f/4.0f, 5.0f/6.0f,
-        // H, F, D
-        1.0f/4.0f, 5.0f/6.0f,
-        2.0f/4.0f, 5.0f/6.0f,
-        1.0f/4.0f, 6.0f/6.0f,
-
-        // Bottom face
-        // G, H, C
-        2.0f/4.0f, 5.0f/6.0f,
-        3.0f/4.0f, 5.0f/6.0f,
-        2.0f/4.0f, 6.0f/6.0f,
-        // D, C, H
-        3.0f/4.0f, 6.0f/6.0f,
-        2.0f/4.0f, 6.0f/6.0f,
-        3.0f/4.0f, 5.0f/6.0f,
-    };
+    unsigned int VBO, EBO;
 
-    unsigned int VBO_position, VBO_texCoords;
+    glGenVertexArrays(1, &cubeVAO);
+    glBindVertexArray(cubeVAO);
 
-    glGenVertexArrays(1, &wormHeadVAO);
-    glBindVertexArray(wormHeadVAO);
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(CubeVertex), vertices.data(), GL_STATIC_DRAW);
 
-    glGenBuffers(1, &VBO_position);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_position);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(position), position, GL_STATIC_DRAW);
+    glGenBuffers(1, &EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), indices.data(), GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0,3,GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
+    // Position attribute (int8 half units, converted to float)
+    glVertexAttribPointer(0, 3, GL_BYTE, GL_FALSE, sizeof(CubeVertex), (void *) offsetof(CubeVertex, x));
     glEnableVertexAttribArray(0);
 
-    glGenBuffers(1, &VBO_texCoords);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_texCoords);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(texCoords), texCoords, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 & sizeof(float), 0);
+    // Texture coordinate attribute (uint8 tile-local uv and atlas layer, converted to float)
+    glVertexAttribPointer(1, 3, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(CubeVertex), (void *) offsetof(CubeVertex, u));
     glEnableVertexAttribArray(1);
+
+    setInstanceAttributes(0);
 }
 
-void makeDirtBlockVAOAndVBO()
+void makeTerrainVAO()
 {
-    const float position[] = 
-    {
-        // Front face
-        // A, C, B
-        -0.5f,  0.5f,  0.5f,
-        -0.5f, -0.5f,  0.5f,
-        0.5f,  0.5f,  0.5f,
-        // D, B, C
-        0.5f, -0.5f,  0.5f,
-        0.5f,  0.5f,  0.5f,
-        -0.5f, -0.5f,  0.5f,
-
-        // Back face
-        // E, F, G
-        -0.5f,  0.5f, -0.5f,
-        0.5f,  0.5f, -0.5f,
-        -0.5f, -0.5f, -0.5f,
-        // H, G, F
-        0.5f, -0.5f, -0.5f,
-        -0.5f, -0.5f, -0.5f,
-        0.5f,  0.5f, -0.5f,
-
-        // Top face
-        // E, A, F
-        -0.5f,  0.5f, -0.5f,
-        -0.5f,  0.5f,  0.5f,
-        0.5f,  0.5f, -0.5f,
-        // B, F, A
-        0.5f,  0.5f,  0.5f,
-        0.5f,  0.5f, -0.5f,
-        -0.5f,  0.5f,  0.5f,
-
-        // Left face
-        // A, E, C
-        -0.5f,  0.5f,  0.5f,
-        -0.5f,  0.5f, -0.5f,
-        -0.5f, -0.5f,  0.5f,
-        // G, C, E
-        -0.5f, -0.5f, -0.5f,
-        -0.5f, -0.5f,  0.5f,
-        -0.5f,  0.5f, -0.5f,
-
-        // Right face
-        // B, D, F
-        0.5f,  0.5f,  0.5f,
-        0.5f, -0.5f,  0.5f,
-        0.5f,  0.5f, -0.5f,
-        // H, F, D
-        0.5f, -0.5f, -0.5f,
-        0.5f,  0.5f, -0.5f,
-        0.5f, -0.5f,  0.5f,
-
-        // Bottom face
-        // G, H, C
-        -0.5f, -0.5f, -0.5f,
-        0.5f, -0.5f, -0.5f,
-        -0.5f, -0.5f,  0.5f,
-        // D, C, H
-        0.5f, -0.5f,  0.5f,
-        -0.5f, -0.5f,  0.5f,
-        0.5f, -0.5f, -0.5f
-    };
-
-    const float texCoords[] = 
-    {
-        // Front face
-        // A, C, B
-        2.0f/4.0f, 4.0f/6.0f,
-        2.0f/4.0f, 3.0f/6.0f,
-        3.0f/4.0f, 4.0f/6.0f,
-        // D, B, C
-        3.0f/4.0f, 3.0f/6.0f,
-        3.0f/4.0f, 4.0f/6.0f,
-        2.0f/4.0f, 3.0f/6.0f,
-
-        // Back face
-        // E, F, G
-        3.0f/4.0f, 4.0f/6.0f,
-        2.0f/4.0f, 4.0f/6.0f,
-        3.0f/4.0f, 3.0f/6.0f,
-        // H, G, F
-        2.0f/4.0f, 3.0f/6.0f,
-        3.0f/4.0f, 3.0f/6.0f,
-        2.0f/4.0f, 4.0f/6.0f,
-
-        // Top face
-        // E, A, F
-        2.0f/4.0f, 4.0f/6.0f,
-        2.0f/4.0f, 3.0f/6.0f,
-        3.0f/4.0f, 4.0f/6.0f,
-        // B, F, A
-        3.0f/4.0f, 3.0f/6.0f,
-        3.0f/4.0f, 4.0f/6.0f,
-        2.0f/4.0f, 3.0f/6.0f,
-
-        // Left face
-        // A, E, C
-        3.0f/4.0f, 4.0f/6.0f,
-        2.0f/4.0f, 4.0f/6.0f,
-        3.0f/4.0f, 3.0f/6.0f,
-        // G, C, E
-        2.0f/4.0f, 3.0f/6.0f,
-        3.0f/4.0f, 3.0f/6.0f,
-        2.0f/4.0f, 4.0f/6.0f,
-
-        // Right face
-        // B, D, F
-        2.0f/4.0f, 4.0f/6.0f,
-        2.0f/4.0f, 3.0f/6.0f,
-        3.0f/4.0f, 4.0f/6.0f,
-        // H, F, D
-        3.0f/4.0f, 3.0f/6.0f,
-        3.0f/4.0f, 4.0f/6.0f,
-        2.0f/4.0f, 3.0f/6.0f,
-
-        // Bottom face
-        // G, H, C
-        2.0f/4.0f, 3.0f/6.0f,
-        3.0f/4.0f, 3.0f/6.0f,
-        2.0f/4.0f, 4.0f/6.0f,
-        // D, C, H
-        3.0f/4.0f, 4.0f/6.0f,
-        2.0f/4.0f, 4.0f/6.0f,
-        3.0f/4.0f, 3.0f/6.0f,
-    };
+    std::vector<float> vertices;
+    bakeTerrain(vertices, terrainChunks);
 
-    unsigned int VBO_position, VBO_texCoords;
+    unsigned int VBO;
 
-    glGenVertexArrays(1, &dirtBlockVAO);
-    glBindVertexArray(dirtBlockVAO);
+    glGenVertexArrays(1, &terrainVAO);
+    glBindVertexArray(terrainVAO);
 
-    glGenBuffers(1, &VBO_position);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_position);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(position), position, GL_STATIC_DRAW);
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0,3,GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
+    // Position attribute
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, TERRAIN_VERTEX_SIZE * sizeof(float), (void *) 0);
     glEnableVertexAttribArray(0);
 
-    glGenBuffers(1, &VBO_texCoords);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_texCoords);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(texCoords), texCoords, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 & sizeof(float), 0);
+    // Tile-local texture coordinate attribute
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, TERRAIN_VERTEX_SIZE * sizeof(float), (void *) (3 * sizeof(float)));
     glEnableVertexAttribArray(1);
+
+    // Atlas layer attribute
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, TERRAIN_VERTEX_SIZE * sizeof(float), (void *) (5 * sizeof(float)));
+    glEnableVertexAttribArray(2);
 }
 
-void makeShaderProgram()
+void makeTerrainShaderProgram()
 {
     // Create shader program
+    // Terrain faces are merged, their tile-local coordinates repeat the tile's atlas layer across each face.
 
     const char *vertexShaderSource = "#version 330 core\n"
         "layout (location = 0) in vec3 aPos;\n"
-        "layout (location = 1) in vec2 aTexCoord;\n"
+        "layout (location = 1) in vec2 aTexCoord;\n" // tile-local, one unit per block
+        "layout (location = 2) in float aLayer;\n"
         "out vec2 TexCoord;\n"
-        "uniform mat4 model;\n"
-        "uniform mat4 view;\n"
-        "uniform mat4 projection;\n"
+        "flat out float Layer;\n"
+        CAMERA_BLOCK_SOURCE
         "void main()\n"
         "{\n"
-        "   gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
+        "   gl_Position = projection * view * parent * vec4(aPos, 1.0);\n"
         "   TexCoord = aTexCoord;\n"
+        "   Layer = aLayer;\n"
         "}\0";
     const char *fragmentShaderSource = "#version 330 core\n"
         "in vec2 TexCoord;\n"
+        "flat in float Layer;\n"
         "out vec4 FragColor;\n"
-        "uniform sampler2D ourTexture;"
+        "uniform sampler2DArray ourTexture;"
         "void main()\n"
         "{\n"
-        "   FragColor = texture(ourTexture, TexCoord);\n"
+        "   FragColor = texture(ourTexture, vec3(TexCoord, Layer));\n"
         "}\n\0";
-    
-    unsigned int vertexShader, fragmentShader;
-    int success;
-    char infoLog[512];
-
-    // Create vertex shader
-    vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    // If compilation failed, log it
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
 
-    // Create fragment shader
-    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
+    terrainProgram.compile(vertexShaderSource, fragmentShaderSource);
 
-    // If compilation failed, log it
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
+    // Use shader
+    terrainProgram.use();
+    terrainProgram.setInt(terrainProgram.getUniformLocation("ourTexture"), 0);
+    glEnable(GL_DEPTH_TEST);
+}
 
-    // Create shader program
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    // If linking failed, log it
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
+void makeInstancedShaderProgram()
+{
+    // Shader for cube entities (snake, apples) drawn with instanced draw calls.
+    // Each instance supplies its grid position, Direction and CubeType.
+    // Directions index the DIRECTION_ROTATIONS table (uploaded once), so no per-part
+    // matrices are ever built on the CPU.
+    // Animation runs here: apples spin with time, snake parts slide from their
+    // previous cell to the current one as the tick phase goes from 0 to 1.
+
+    const char *vertexShaderSource = "#version 330 core\n"
+        "layout (location = 0) in vec3 aPos;\n" // half units
+        "layout (location = 1) in vec3 aTexCoord;\n" // tile-local uv, atlas layer
+        "layout (location = 2) in vec3 aOffset;\n"
+        "layout (location = 3) in int aDirection;\n"
+        "layout (location = 4) in int aType;\n"
+        "layout (location = 5) in vec3 aFromOffset;\n"
+        "out vec3 TexCoord;\n"
+        CAMERA_BLOCK_SOURCE
+        "uniform float time;\n" // seconds
+        "uniform float tickPhase;\n" // 0..1 since the last move
+        "uniform mat3 directionRotations[6];\n" // DIRECTION_ROTATIONS
+        "void main()\n"
+        "{\n"
+        "   const float APPLE_SPIN_SPEED = radians(" STR(APPLE_SPIN_SPEED) ");\n"
+        "   vec3 corner = 0.5 * aPos;\n"
+        "   vec3 pos;\n"
+        "   if (aType == " STR(CUBE_TYPE_APPLE) ")\n"
+        "   {\n"
+        "       float c = cos(time * APPLE_SPIN_SPEED);\n"
+        "       float s = sin(time * APPLE_SPIN_SPEED);\n"
+        "       pos = 0.7 * vec3(c * corner.x + s * corner.z, corner.y, c * corner.z - s * corner.x);\n"
+        "   }\n"
+        "   else\n"
+        "   {\n"
+        "       pos = directionRotations[aDirection] * corner;\n"
+        "   }\n"
+        "   vec3 offset = mix(aFromOffset, aOffset, tickPhase);\n"
+        "   gl_Position = projection * view * parent * vec4(pos + offset, 1.0);\n"
+        "   TexCoord = aTexCoord;\n"
+        "}\0";
+    const char *fragmentShaderSource = "#version 330 core\n"
+        "in vec3 TexCoord;\n"
+        "out vec4 FragColor;\n"
+        "uniform sampler2DArray ourTexture;"
+        "void main()\n"
+        "{\n"
+        "   FragColor = texture(ourTexture, TexCoord);\n"
+        "}\n\0";
 
-    // Delete shaders
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    instancedProgram.compile(vertexShaderSource, fragmentShaderSource);
 
-    // Use shader
-    glUseProgram(shaderProgram);
-    glEnable(GL_DEPTH_TEST);
+    instancedTimeLocation = instancedProgram.getUniformLocation("time");
+    instancedTickPhaseLocation = instancedProgram.getUniformLocation("tickPhase");
+
+    instancedProgram.use();
+    instancedProgram.setInt(instancedProgram.getUniformLocation("ourTexture"), 0);
+    instancedProgram.setMat3Array(instancedProgram.getUniformLocation("directionRotations"), DIRECTION_ROTATIONS[0], 6);
 }
 
 void makeBackGroundShaderProgram()
 {
-    // Draw BG first!
+    // Drawn after the scene, at the far plane (see submitCommands())
 
     // Create shader program
 
@@ -912,7 +507,7 @@ void makeBackGroundShaderProgram()
         "out float y;\n"
         "void main()\n"
         "{\n"
-        "   gl_Position = vec4(aPos, 1.0);\n" // MAKE SURE SQUARE IS ALREADY NDC
+        "   gl_Position = vec4(aPos.xy, 1.0, 1.0);\n" // MAKE SURE SQUARE IS ALREADY NDC, depth 1.0 (far plane)
         "   y = aPos.y;\n"
         "}\0";
     const char *fragmentShaderSource = "#version 330 core\n"
@@ -925,54 +520,8 @@ void makeBackGroundShaderProgram()
         "   vec3 lerp = blue * ((y + 1.0)/4.0) + white * (1 - (y + 1.0)/4.0);\n"
         "   FragColor = vec4(lerp, 1.0);\n" // LERP GOES HERE
         "}\n\0";
-    
-    unsigned int vertexShader, fragmentShader;
-    int success;
-    char infoLog[512];
-
-    // Create vertex shader
-    vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    // If compilation failed, log it
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    // Create fragment shader
-    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    // If compilation failed, log it
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
 
-    // Create shader program
-    shaderProgramBG = glCreateProgram();
-    glAttachShader(shaderProgramBG, vertexShader);
-    glAttachShader(shaderProgramBG, fragmentShader);
-    glLinkProgram(shaderProgramBG);
-
-    // If linking failed, log it
-    glGetProgramiv(shaderProgramBG, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(shaderProgramBG, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-
-    // Delete shaders
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    backgroundProgram.compile(vertexShaderSource, fragmentShaderSource);
 }
 
 void makeBGVAO()
@@ -1009,93 +558,468 @@ void makeBGVAO()
     glEnableVertexAttribArray(0);
 }
 
-void drawDirtCube(const glm::mat4& parent)
-{   
-    const unsigned int SIZE_OF_CUBE = 5;
-    const int STARTING_INDEX = SIZE_OF_CUBE - ceil(((double) SIZE_OF_CUBE)/2.0); // positive
-    const int LAST_INDEX = STARTING_INDEX - (SIZE_OF_CUBE - 1); // negative
+/**
+ * Creates the stream the frame's draw commands are written to (4.3 only).
+ */
+void makeIndirectBuffer()
+{
+    if (!isIndirectSupported)
+    {
+        return;
+    }
+
+    // room for every terrain chunk, and for every entity instance in its own command
+    const size_t size = terrainChunks.size() * sizeof(DrawArraysIndirectCommand) + INSTANCE_CAPACITY * sizeof(DrawElementsIndirectCommand);
+
+    commandStream.create(GL_DRAW_INDIRECT_BUFFER, size);
+}
+
+/**
+ * Adds chunk, or its children if it is too large on screen, to terrainChunkOrder.
+ * distances holds the distance of every chunk's center to the camera.
+ */
+void selectTerrainChunk(unsigned int index, const std::vector<float>& distances, float pixelsPerUnit)
+{
+    const TerrainChunk& chunk = terrainChunks[index];
 
-    for (int y  = STARTING_INDEX; y >= LAST_INDEX - 15; y--)
+    // projected size of the chunk's bounding sphere
+    const float radius = 0.5f * glm::length(glm::vec3(chunk.max[0] - chunk.min[0], chunk.max[1] - chunk.min[1], chunk.max[2] - chunk.min[2]));
+    const bool isSmall = distances[index] > radius && 2.0f * radius / distances[index] * pixelsPerUnit < TERRAIN_LOD_PIXELS;
+
+    if (chunk.childCount == 0 || isSmall)
     {
-        if (y == STARTING_INDEX)
+        terrainChunkOrder.push_back(index);
+        return;
+    }
+
+    for (int i = 0; i < chunk.childCount; i++)
+    {
+        selectTerrainChunk(chunk.children[i], distances, pixelsPerUnit);
+    }
+}
+
+/**
+ * Picks the level of detail of every terrain region and orders the selected
+ * chunks front to back, in terrainChunkOrder: by the distance of each chunk's
+ * center to the camera, with the current parent rotation applied.
+ * 
+ * Both only depend on the rotation, so they are recomputed when the angles change
+ * (see updateCamera()), not every frame.
+ */
+void selectTerrainChunks()
+{
+    const glm::mat4 modelView = view * parent;
+
+    // pixels covered by one unit at distance one
+    const float pixelsPerUnit = projection[1][1] * SCR_HEIGHT / 2.0f;
+
+    std::vector<float> distances(terrainChunks.size());
+    for (unsigned int i = 0; i < terrainChunks.size(); i++)
+    {
+        const TerrainChunk& chunk = terrainChunks[i];
+        const glm::vec3 center = 0.5f * glm::vec3(chunk.min[0] + chunk.max[0], chunk.min[1] + chunk.max[1], chunk.min[2] + chunk.max[2]);
+        distances[i] = glm::length(glm::vec3(modelView * glm::vec4(center, 1.0f)));
+    }
+
+    terrainChunkOrder.clear();
+    for (unsigned int i = 0; i < terrainChunks.size(); i++)
+    {
+        if (terrainChunks[i].level == TERRAIN_LOD_LEVELS - 1)
         {
-            glBindVertexArray(dirtWithGrassVAO);
+            selectTerrainChunk(i, distances, pixelsPerUnit);
         }
-        else
+    }
+
+    std::sort(terrainChunkOrder.begin(), terrainChunkOrder.end(), [&distances](unsigned int a, unsigned int b)
+    {
+        return distances[a] < distances[b];
+    });
+}
+
+/**
+ * Fills terrainCommands with one draw per selected terrain chunk inside the view
+ * frustum, front to back, and terrainCommandDepths with each chunk's rank in that order.
+ * 
+ * The order holds for the indirect command list as well as the render queue,
+ * so near chunks fill the depth buffer first and hidden fragments are rejected early.
+ */
+void buildTerrainCommands(const Frustum& frustum)
+{
+    terrainCommands.clear();
+    terrainCommandDepths.clear();
+
+    for (unsigned int rank = 0; rank < terrainChunkOrder.size(); rank++)
+    {
+        const TerrainChunk& chunk = terrainChunks[terrainChunkOrder[rank]];
+
+        if (frustum.containsBox(glm::vec3(chunk.min[0], chunk.min[1], chunk.min[2]), glm::vec3(chunk.max[0], chunk.max[1], chunk.max[2])))
+        {
+            DrawArraysIndirectCommand command;
+            command.count = chunk.vertexCount;
+            command.instanceCount = 1;
+            command.first = chunk.firstVertex;
+            command.baseInstance = 0;
+            terrainCommands.push_back(command);
+            terrainCommandDepths.push_back(rank);
+        }
+    }
+}
+
+// Visible instances in consecutive slots, drawn with a single command
+struct InstanceRun
+{
+    CubeVariant variant;
+    unsigned int first;
+    unsigned int count;
+};
+
+void addEntityCommand(const InstanceRun& run)
+{
+    const CubeVariantRange& range = cubeVariants[(int) run.variant];
+
+    DrawElementsIndirectCommand command;
+    command.count = range.indexCount;
+    command.instanceCount = run.count;
+    command.firstIndex = range.firstIndex;
+    command.baseVertex = range.baseVertex;
+    command.baseInstance = run.first;
+    entityCommands.push_back(command);
+}
+
+/**
+ * Adds the instance in slot to run if it is visible and directly follows the run,
+ * otherwise emits the run and starts a new one.
+ */
+void extendInstanceRun(InstanceRun& run, unsigned int slot, bool isVisible)
+{
+    if (run.count > 0 && (!isVisible || slot != run.first + run.count))
+    {
+        addEntityCommand(run);
+        run.count = 0;
+    }
+
+    if (isVisible)
+    {
+        if (run.count == 0)
         {
-            glBindVertexArray(dirtBlockVAO);
+            run.first = slot;
         }
+        run.count++;
+    }
+}
+
+void endInstanceRun(InstanceRun& run)
+{
+    if (run.count > 0)
+    {
+        addEntityCommand(run);
+        run.count = 0;
+    }
+}
+
+unsigned int getSnakeSlot(int part)
+{
+    return SNAKE_FIRST_INSTANCE + (snakeHeadSlot + part) % MAX_SNAKE_SIZE;
+}
+
+/**
+ * Fills entityCommands with instanced draws of the entities inside the view frustum.
+ * Culling only picks slots of the instance buffer, it never rewrites it: visible
+ * instances in consecutive slots share a command, the snake ring wrapping around
+ * splits the body in two.
+ */
+void buildEntityCommands(const Frustum& frustum)
+{
+    // radius of the sphere enclosing a unit cube, grown by the one cell a snake part slides per tick
+    const float CUBE_RADIUS = 1.87f;
 
-        for (int x = STARTING_INDEX + 15; x >= LAST_INDEX - 15; x--)
+    entityCommands.clear();
+
+    const SnakePart * snake = game->snake;
+    InstanceRun head = {CubeVariant::WormHead, 0, 0};
+    InstanceRun body = {CubeVariant::WormBody, 0, 0};
+    for (int i = 0; i < game->snakeSize; i++)
+    {
+        const bool isVisible = frustum.containsSphere(glm::vec3(snake[i].x, snake[i].y, snake[i].z), CUBE_RADIUS);
+        extendInstanceRun((i == 0) ? head : body, getSnakeSlot(i), isVisible);
+    }
+    endInstanceRun(head);
+    endInstanceRun(body);
+
+    const Apple * apples = game->apples;
+    InstanceRun apple = {CubeVariant::Apple, 0, 0};
+    for (int i = 0; i < game->applesSize; i++)
+    {
+        const bool isVisible = frustum.containsSphere(glm::vec3(apples[i].x, apples[i].y, apples[i].z), CUBE_RADIUS);
+        extendInstanceRun(apple, APPLE_FIRST_INSTANCE + i, isVisible);
+    }
+    endInstanceRun(apple);
+}
+
+/**
+ * Submits the frame's draw commands.
+ * 
+ * Indirect mode uploads them to the draw command buffer and draws the terrain
+ * and the entities with one indirect call each. Direct mode (3.3 contexts)
+ * issues the same commands with regular draw calls. Either way the draws go
+ * through the render queue, which sorts them by state and drops redundant binds.
+ * The background is queued as its own pass after the opaque geometry.
+ */
+void submitCommands()
+{
+    size_t terrainCommandsOffset = 0;
+    size_t entityCommandsOffset = 0;
+
+    if (renderMode == RenderMode::Indirect)
+    {
+        // write the commands straight into this frame's region of the command stream
+        unsigned char * commands = (unsigned char *) commandStream.map();
+        const size_t terrainCommandsSize = terrainCommands.size() * sizeof(DrawArraysIndirectCommand);
+        memcpy(commands, terrainCommands.data(), terrainCommandsSize);
+        memcpy(commands + terrainCommandsSize, entityCommands.data(), entityCommands.size() * sizeof(DrawElementsIndirectCommand));
+        commandStream.unmap();
+
+        terrainCommandsOffset = commandStream.getRegionOffset();
+        entityCommandsOffset = terrainCommandsOffset + terrainCommandsSize;
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandStream.getId());
+    }
+
+    renderQueue.clear();
+
+    // Terrain
+    // terrain is baked in place, so the parent rotation is its model matrix
+
+    DrawItem terrainItem;
+    terrainItem.program = terrainProgram.getId();
+    terrainItem.vao = terrainVAO;
+    terrainItem.texture = textureAtlas;
+
+    if (renderMode == RenderMode::Indirect && !terrainCommands.empty())
+    {
+        terrainItem.call = DrawCall::MultiArraysIndirect;
+        terrainItem.indirectOffset = terrainCommandsOffset;
+        terrainItem.count = terrainCommands.size();
+        renderQueue.push(terrainItem);
+    }
+    else if (renderMode == RenderMode::Direct)
+    {
+        for (unsigned int i = 0; i < terrainCommands.size(); i++)
         {
-            for (int z = STARTING_INDEX; z >= LAST_INDEX - 15; z--)
-            {
-                // skip zone where worm moves
-                if (
-                    y <= STARTING_INDEX && y >= LAST_INDEX &&
-                    x <= STARTING_INDEX && x >= LAST_INDEX &&
-                    z <= STARTING_INDEX && z >= LAST_INDEX
-                )
-                {
-                    continue;
-                }
+            terrainItem.call = DrawCall::Arrays;
+            terrainItem.first = terrainCommands[i].first;
+            terrainItem.count = terrainCommands[i].count;
+            terrainItem.depth = terrainCommandDepths[i];
+            renderQueue.push(terrainItem);
+        }
+    }
 
-                glm::mat4 child = glm::mat4(1.0f);
-                child = glm::translate(child, glm::vec3(x,y,z));
-                glm::mat4 model = glm::mat4(parent * child);
+    // Snake and apples
+    // every variant lives in the cube VAO, a draw picks one by its index range
 
-                glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-                glDrawArrays(GL_TRIANGLES, 0, 36);
-            }
+    DrawItem entityItem;
+    entityItem.program = instancedProgram.getId();
+    entityItem.vao = cubeVAO;
+    entityItem.texture = textureAtlas;
+    entityItem.indexType = GL_UNSIGNED_BYTE;
+
+    if (renderMode == RenderMode::Indirect && !entityCommands.empty())
+    {
+        entityItem.call = DrawCall::MultiElementsIndirect;
+        entityItem.indirectOffset = entityCommandsOffset;
+        entityItem.count = entityCommands.size();
+        renderQueue.push(entityItem);
+    }
+    else if (renderMode == RenderMode::Direct)
+    {
+        // no base instance before 4.2, the queue points the instance attributes at the range instead
+        for (const DrawElementsIndirectCommand& command : entityCommands)
+        {
+            entityItem.call = DrawCall::ElementsInstanced;
+            entityItem.first = command.firstIndex;
+            entityItem.count = command.count;
+            entityItem.instanceCount = command.instanceCount;
+            entityItem.baseVertex = command.baseVertex;
+            entityItem.firstInstance = command.baseInstance;
+            renderQueue.push(entityItem);
         }
     }
+
+    // per-frame uniforms of the instanced program
+    instancedProgram.use();
+    // wrapped at a full apple turn, so the float time keeps its precision
+    instancedProgram.setFloat(instancedTimeLocation, fmod(animationTime, 360.0 / APPLE_SPIN_SPEED));
+    instancedProgram.setFloat(instancedTickPhaseLocation, tickPhase);
+
+    // Background
+    // last, at the far plane: early depth testing skips every pixel the scene covered
+
+    DrawItem backgroundItem;
+    backgroundItem.pass = RenderPass::Background;
+    backgroundItem.program = backgroundProgram.getId();
+    backgroundItem.vao = bgVAO;
+    backgroundItem.texture = textureAtlas; // unused, avoids a rebind
+    backgroundItem.depthFunc = GL_LEQUAL;
+    backgroundItem.call = DrawCall::Arrays;
+    backgroundItem.first = 0;
+    backgroundItem.count = 6;
+    renderQueue.push(backgroundItem);
+
+    renderQueue.submit();
+
+    // the GPU reads this frame's command region until these commands complete
+    if (renderMode == RenderMode::Indirect)
+    {
+        commandStream.fence();
+    }
 }
 
-void setSnakePartModel(int x, int y, int z, Direction dir, const glm::mat4& parent)
+/**
+ * Writes snake part i into its slot of the instance buffer, sliding from cell from.
+ * The head is picked by its draw command, so every snake slot is typed as body and
+ * stays valid when the head moves on.
+ * 
+ * A slot slides from the cell of the next slot (the part behind it), which is the
+ * cell the old head held when the slot was written as the new head. Slots written
+ * that way, or by a full rewrite, slide along the snake during every later tick
+ * without further writes.
+ */
+void writeSnakeInstance(int i, const SnakePart& from)
 {
-    glm::mat4 child = glm::mat4(1.0f);
-    child = glm::translate(child, glm::vec3(x,y,z));
+    const SnakePart& part = game->snake[i];
+
+    CubeInstance instance;
+    instance.x = part.x;
+    instance.y = part.y;
+    instance.z = part.z;
+    instance.fromX = from.x;
+    instance.fromY = from.y;
+    instance.fromZ = from.z;
+    instance.dir = (int) part.dir;
+    instance.type = CUBE_TYPE_WORM_BODY;
+
+    glBufferSubData(GL_ARRAY_BUFFER, getSnakeSlot(i) * sizeof(CubeInstance), sizeof(CubeInstance), &instance);
+    instanceWriteCount++;
+}
+
+void writeAppleInstances()
+{
+    CubeInstance instances[MAX_APPLES];
 
-    if (dir == Direction::Left)
+    const Apple * apples = game->apples;
+    for (int i = 0; i < game->applesSize; i++)
     {
-        child = glm::rotate(child, glm::radians(-90.f), glm::vec3(0,1,0));
+        instances[i].x = apples[i].x;
+        instances[i].y = apples[i].y;
+        instances[i].z = apples[i].z;
+        instances[i].fromX = apples[i].x;
+        instances[i].fromY = apples[i].y;
+        instances[i].fromZ = apples[i].z;
+        instances[i].dir = (int) Direction::Forward;
+        instances[i].type = CUBE_TYPE_APPLE;
     }
-    else if (dir == Direction::Right)
+
+    glBufferSubData(GL_ARRAY_BUFFER, APPLE_FIRST_INSTANCE * sizeof(CubeInstance), game->applesSize * sizeof(CubeInstance), instances);
+    instanceWriteCount += game->applesSize;
+}
+
+/**
+ * Brings the instance buffer up to date with the game state.
+ * 
+ * Nothing is uploaded while the game generation is unchanged. After a single move
+ * only the new head (and the old head if it turned, the tail if the snake grew) is
+ * written; the dropped tail simply falls out of the snake's slot range. Anything else,
+ * like a reset or a missed generation, rewrites every instance, each part sliding from
+ * the cell of the part behind it. After a reset the parts are placed without sliding
+ * (the snapshot didn't move), after missed moves they slide on the rewrite frame too.
+ */
+void updateEntityInstances()
+{
+    const unsigned int generation = game->generation;
+    if (areInstancesValid && generation == instanceGeneration)
     {
-        child = glm::rotate(child, glm::radians(90.f), glm::vec3(0,1,0));
+        return;
     }
-    else if (dir == Direction::Up)
+
+    const SnakeChange& change = game->change;
+    const bool isIncremental = areInstancesValid && generation == instanceGeneration + 1 && change.moved;
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+
+    const SnakePart * snake = game->snake;
+    const int snakeSize = game->snakeSize;
+
+    if (isIncremental)
     {
-        child = glm::rotate(child, glm::radians(-90.f), glm::vec3(1,0,0));
+        snakeHeadSlot = (snakeHeadSlot + MAX_SNAKE_SIZE - 1) % MAX_SNAKE_SIZE;
+        writeSnakeInstance(0, snake[1]);
+
+        if (change.neckTurned)
+        {
+            writeSnakeInstance(1, snake[2]);
+        }
+
+        // a grown tail stays where it is for this tick
+        if (change.grew)
+        {
+            writeSnakeInstance(snakeSize - 1, snake[snakeSize - 1]);
+        }
     }
-    else if (dir == Direction::Down)
+    else
     {
-        child = glm::rotate(child, glm::radians(90.f), glm::vec3(1,0,0));
+        snakeHeadSlot = 0;
+        for (int i = 0; i < snakeSize; i++)
+        {
+            writeSnakeInstance(i, (i + 1 < snakeSize) ? snake[i + 1] : snake[i]);
+        }
     }
-    else if (dir == Direction::Backward)
+
+    if (!isIncremental || change.applesChanged)
     {
-        child = glm::rotate(child, glm::radians(180.f), glm::vec3(0,1,0));
+        writeAppleInstances();
     }
-    // else dir == Forward
-        // no rotation
 
-    glm::mat4 model = glm::mat4(parent * child);
+    instanceGeneration = generation;
+    areInstancesValid = true;
+    instanceUploadCount++;
+}
+
+/**
+ * Sets up the fixed projection and view, and the Camera uniform buffer.
+ * Must be called before any shader program is linked.
+ */
+void makeCamera()
+{
+    projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+
+    // note that we're translating the scene in the reverse direction of where we want to move
+    view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -10.0f));
 
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    cameraBuffer.create();
+    ShaderProgram::addSharedUniformBlock("Camera", CAMERA_BLOCK_BINDING);
 }
 
-void drawApple(int x, int y, int z, const glm::mat4& parent)
+/**
+ * Rebuilds the parent rotation (and the terrain chunk selection) when the cube
+ * angles changed, and uploads the camera block if anything in it changed.
+ */
+void updateCamera()
 {
+    static float parentXAngel = NAN;
+    static float parentYAngel = NAN;
+
+    if (xAngel != parentXAngel || yAngel != parentYAngel)
+    {
+        parent = glm::mat4(1.0f);
+        parent = glm::rotate(parent, glm::radians(yAngel), glm::vec3(0.0, 1.0, 0.0));
+        parent = glm::rotate(parent, glm::radians(xAngel), glm::vec3(1.0, 0.0, 0.0));
 
-    glm::mat4 child = glm::mat4(1.0f);
-    child = glm::translate(child, glm::vec3(x,y,z));
-    child = glm::scale(child, glm::vec3(.70f, .70f, .70f));
-    child = glm::rotate(child, glm::radians(appleRotationAngel), glm::vec3(0,1,0));
-    glm::mat4 model = glm::mat4(parent * child);
+        parentXAngel = xAngel;
+        parentYAngel = yAngel;
+
+        selectTerrainChunks();
+    }
 
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    glBindVertexArray(appleVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36); 
+    cameraBuffer.update(projection, view, parent);
 }
 
 void render()
@@ -1104,43 +1028,98 @@ void render()
     // glClearColor(0.3f, 0.0f, 0.0f, 1.0f);
     // glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glm::mat4 projection;
-    projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    updateCamera();
 
-    glm::mat4 view = glm::mat4(1.0f);
-    // note that we're translating the scene in the reverse direction of where we want to move
-    view = glm::translate(view, glm::vec3(0.0f, 0.0f, -10.0f));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    // terrain and entities are in parent space, so cull against it
+    const Frustum frustum(projection * view * parent);
+
+    buildTerrainCommands(frustum);
 
-    glm::mat4 parent = glm::mat4(1.0f);
-    parent = glm::rotate(parent, glm::radians(yAngel), glm::vec3(0.0, 1.0, 0.0));
-    parent = glm::rotate(parent, glm::radians(xAngel), glm::vec3(1.0, 0.0, 0.0));
+    updateEntityInstances();
+    buildEntityCommands(frustum);
 
-    drawDirtCube(parent);
+    submitCommands();
+}
+
+void printStats()
+{
+    std::cout << "Stats:\n";
+    std::cout << "  simulation thread: " << game->tick << " ticks, " << game->droppedTicks << " dropped, slip "
+              << game->averageSlip * 1000.0 << " ms average, " << game->maxSlip * 1000.0 << " ms max, longest tick "
+              << game->maxTickTime * 1000.0 << " ms\n";
+    std::cout << "  render thread: " << snapshotCount << " snapshots (" << game->overwrittenSnapshots << " overwritten unseen), latency "
+              << (snapshotCount > 0 ? snapshotLatencySum / snapshotCount : 0.0) * 1000.0 << " ms average, "
+              << maxSnapshotLatency * 1000.0 << " ms max\n";
+    std::cout << "  input: " << game->turns << " turns, " << game->droppedTurns << " dropped, key to tick "
+              << game->averageInputLatency * 1000.0 << " ms average, " << game->maxInputLatency * 1000.0 << " ms max\n";
+    const double frameTime = framePacer.getAverageFrameTime();
+    std::cout << "  frame pacing: " << framePacer.getModeName() << ", " << framePacer.getFrameCount() << " frames, "
+              << frameTime * 1000.0 << " ms average (" << (frameTime > 0.0 ? 1.0 / frameTime : 0.0) << " fps), variance "
+              << framePacer.getFrameTimeVariance() * 1000000.0 << " ms^2 (deviation "
+              << std::sqrt(framePacer.getFrameTimeVariance()) * 1000.0 << " ms), "
+              << framePacer.getMaxFrameTime() * 1000.0 << " ms max\n";
+    std::cout << "  redraw: " << (isRenderOnDemand ? "on demand" : "continuous") << ", " << redrawTracker.getDrawCount()
+              << " frames drawn (camera " << redrawTracker.getReasonCount(REDRAW_CAMERA) << ", game "
+              << redrawTracker.getReasonCount(REDRAW_GAME) << ", animation " << redrawTracker.getReasonCount(REDRAW_ANIMATION)
+              << ", window " << redrawTracker.getReasonCount(REDRAW_WINDOW) << "), " << redrawTracker.getWaitCount()
+              << " waits (" << redrawTracker.getWaitTime() << " s idle)\n";
+    std::cout << "  instance buffer: " << instanceUploadCount << " updates, "
+              << instanceWriteCount << " instances written\n";
+    int terrainVertexCount = 0;
+    for (unsigned int index : terrainChunkOrder)
+    {
+        terrainVertexCount += terrainChunks[index].vertexCount;
+    }
+    std::cout << "  terrain: " << terrainChunkOrder.size() << " chunks selected (" << terrainVertexCount << " vertices), "
+              << terrainCommands.size() << " in view\n";
+    std::cout << "  render queue: " << renderQueue.getBindCount() << " binds, "
+              << renderQueue.getBindsSaved() << " binds saved last frame\n";
+    std::cout << "  command stream: " << commandStream.getMapCount() << " frames, "
+              << commandStream.getWaitCount() << " fence waits (" << commandStream.getWaitTime() * 1000.0 << " ms)\n";
+}
+
+/**
+ * Picks up the latest game snapshot and updates the handoff metrics and the
+ * tick phase of the slide animation.
+ */
+void updateGame()
+{
+    if (gameSimulation.update() || game == NULL)
+    {
+        game = &gameSimulation.getSnapshot();
 
-    // Draw snake
+        const double latency = glfwGetTime() - game->publishTime;
+        maxSnapshotLatency = std::max(maxSnapshotLatency, latency);
+        snapshotLatencySum += latency;
+        snapshotCount++;
+    }
 
-    // snake head
-    const SnakePart head = snakeLogic.getSnake()[0];
-    setSnakePartModel(head.x, head.y, head.z, head.dir, parent);
-    glBindVertexArray(wormHeadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    if (game->generation != instanceGeneration || !areInstancesValid)
+    {
+        redrawTracker.markDirty(REDRAW_GAME);
+    }
 
-    // snake body
-    for (int i = 1; i < snakeLogic.getSnakeSize(); i++)
+    // draw in between the last two states
+    // (on demand the slide is short, so the snake rests for most of the tick)
+    const double now = glfwGetTime();
+    const double slideTime = isRenderOnDemand ? std::min(ON_DEMAND_SLIDE_TIME, gameSimulation.getTickLength()) : gameSimulation.getTickLength();
+    const float lastTickPhase = tickPhase;
+    tickPhase = game->didMove ? (float) glm::clamp((now - game->tickTime) / slideTime, 0.0, 1.0) : 1.0f;
+    if (tickPhase != lastTickPhase)
     {
-        SnakePart part = snakeLogic.getSnake()[i];
-        setSnakePartModel(part.x, part.y, part.z, part.dir, parent);
-        glBindVertexArray(wormBodyVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 30); 
+        redrawTracker.markDirty(REDRAW_ANIMATION);
     }
 
-    // Draw apples
-    for (int i = 0; i < snakeLogic.getApplesSize(); i++)
+    // apples spin smoothly, or on demand in steps
+    const double lastAnimationTime = animationTime;
+    animationTime = isRenderOnDemand ? std::floor(now / ON_DEMAND_SPIN_STEP) * ON_DEMAND_SPIN_STEP : now;
+    if (game->applesSize > 0)
     {
-        Apple apple = snakeLogic.getApples()[i];
-        drawApple(apple.x, apple.y, apple.z, parent);
+        if (animationTime != lastAnimationTime)
+        {
+            redrawTracker.markDirty(REDRAW_ANIMATION);
+        }
+        redrawTracker.scheduleWake(animationTime + ON_DEMAND_SPIN_STEP);
     }
 }
 
@@ -1162,11 +1141,62 @@ void processInput(GLFWwindow *window)
             // toggle
             isWireFrameModeOn = !isWireFrameModeOn;
             lastDebugToggleTime = glfwGetTime();
+            redrawTracker.markDirty(REDRAW_WINDOW);
+        }
+    }
+
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS && isIndirectSupported)
+    {
+        if (glfwGetTime() - lastDebugToggleTime >= DEBUG_TOGGLE_INTERVAL)
+        {
+            // toggle
+            renderMode = (renderMode == RenderMode::Indirect) ? RenderMode::Direct : RenderMode::Indirect;
+            lastDebugToggleTime = glfwGetTime();
+
+            std::cout << "Render mode: " << ((renderMode == RenderMode::Indirect) ? "indirect" : "direct") << std::endl;
+        }
+    }
+
+    if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS)
+    {
+        if (glfwGetTime() - lastDebugToggleTime >= DEBUG_TOGGLE_INTERVAL)
+        {
+            // cycle
+            const PacingMode next[4] = {PacingMode::Capped, PacingMode::LowLatency, PacingMode::Uncapped, PacingMode::VSync};
+            framePacer.setMode(next[(int) framePacer.getMode()]);
+            lastDebugToggleTime = glfwGetTime();
+
+            std::cout << "Frame pacing: " << framePacer.getModeName() << std::endl;
+        }
+    }
+
+    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS)
+    {
+        if (glfwGetTime() - lastDebugToggleTime >= DEBUG_TOGGLE_INTERVAL)
+        {
+            // toggle
+            isRenderOnDemand = !isRenderOnDemand;
+            lastDebugToggleTime = glfwGetTime();
+            redrawTracker.markDirty(REDRAW_WINDOW);
+
+            std::cout << "Redraw: " << (isRenderOnDemand ? "on demand" : "continuous") << std::endl;
+        }
+    }
+
+    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS)
+    {
+        if (glfwGetTime() - lastDebugToggleTime >= DEBUG_TOGGLE_INTERVAL)
+        {
+            printStats();
+            lastDebugToggleTime = glfwGetTime();
         }
     }
 
     // Cube movement
 
+    const float lastXAngel = xAngel;
+    const float lastYAngel = yAngel;
+
     // up
     if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
     {
@@ -1188,55 +1218,9 @@ void processInput(GLFWwindow *window)
         yAngel += 1;
     }
 
-    // Snake movement
-
-    // Check if snake can't move
-    if (glfwGetTime() - lastMoveTime < MOVE_INTERVAL)
-    {
-        return; // can't move, so skip movement input
-    }
-
-    // up (w)
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (xAngel != lastXAngel || yAngel != lastYAngel)
     {
-        snakeLogic.move(Direction::Up);
-        lastMoveTime = glfwGetTime();
-        return;
-    }
-    // down (s)
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-    {
-        snakeLogic.move(Direction::Down);
-        lastMoveTime = glfwGetTime();
-        return;
-    }
-    // left (a)
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-    {
-        snakeLogic.move(Direction::Left);
-        lastMoveTime = glfwGetTime();
-        return;
-    }
-    // right (d)
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-    {
-        snakeLogic.move(Direction::Right);
-        lastMoveTime = glfwGetTime();
-        return;
-    }
-    // forward (q)
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
-    {
-        snakeLogic.move(Direction::Forward);
-        lastMoveTime = glfwGetTime();
-        return;
-    }
-    // backward (e)
-    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
-    {
-        snakeLogic.move(Direction::Backward);
-        lastMoveTime = glfwGetTime();
-        return;
+        redrawTracker.markDirty(REDRAW_CAMERA);
     }
 }
 
@@ -1250,57 +1234,59 @@ int main()
         return -1;
     }
 
-    makeDirtBlockVAOAndVBO();
-    makeWormBodyVAO();
-    makeAppleVAO();
-    makeDirtWithGrassVAO();
-    makeWormHeadVAO();
-    makeShaderProgram();
+    makeTerrainVAO();
+    makeIndirectBuffer();
+    makeInstanceVBO();
+    makeCubeVAO();
+    makeCamera();
+    makeTerrainShaderProgram();
+    makeInstancedShaderProgram();
     loadTextureAtlas();
     makeBackGroundShaderProgram();
     makeBGVAO();
 
+    renderQueue.setInstanceBinder(setInstanceAttributes);
+
     glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
     glFrontFace(GL_CCW);
 
+    gameSimulation.start();
+
     // render loop
     while (!glfwWindowShouldClose(window))
     {
-        if (snakeLogic.isDead())
-        {
-            snakeLogic.reset();
-        }
-
-        if (glfwGetTime() - lastAppleRotationTime >= APPLE_ROTATION_INTERVAL)
-        {
-            appleRotationAngel += 1;
-            lastAppleRotationTime = glfwGetTime();
+        // wait for the frame start, then read the newest input
+        const double nextTickTime = (game != NULL) ? game->tickTime + gameSimulation.getTickLength() : glfwGetTime();
+        framePacer.beginFrame(nextTickTime);
+        glfwPollEvents();
 
-            if (appleRotationAngel > 360.0f)
-            {
-                appleRotationAngel = 0.0f;
-            }
-        }
+        // the snapshot first, the debug keys read it
+        updateGame();
 
         processInput(window);
-        
 
-        glClearColor(0.3f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // nothing changed: sleep until something does, the gap isn't a frame
+        if (isRenderOnDemand && !redrawTracker.isDirty())
+        {
+            framePacer.restart();
+            redrawTracker.wait();
+            continue;
+        }
 
-        glUseProgram(shaderProgramBG);
-        glBindVertexArray(bgVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        // the background covers every pixel the scene leaves, so only depth needs clearing
+        // (wireframe leaves gaps in both)
+        glClearColor(0.3f, 0.0f, 0.0f, 1.0f);
+        glClear(isWireFrameModeOn ? GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT : GL_DEPTH_BUFFER_BIT);
 
-        glClear(GL_DEPTH_BUFFER_BIT);
-        glUseProgram(shaderProgram);
         render();
 
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        redrawTracker.frameDrawn();
     }
 
+    gameSimulation.stop();
+
     // close window
     glfwTerminate();
 
@@ -0,0 +1,99 @@
+#include "redrawTracker.h"
+
+#include <GLFW/glfw3.h>
+
+void RedrawTracker::markDirty(unsigned int reason)
+{
+    reasons |= reason;
+}
+
+// Something will change the image at time (seconds, glfwGetTime()), the earliest one wins.
+void RedrawTracker::scheduleWake(double time)
+{
+    if (wakeTime < 0.0 || time < wakeTime)
+    {
+        wakeTime = time;
+    }
+}
+
+bool RedrawTracker::isDirty() const
+{
+    return reasons != 0;
+}
+
+// Counts the reasons of the frame just drawn and starts over clean.
+void RedrawTracker::frameDrawn()
+{
+    for (int i = 0; i < REDRAW_REASON_COUNT; i++)
+    {
+        if (reasons & (1 << i))
+        {
+            reasonCounts[i]++;
+        }
+    }
+
+    drawCount++;
+    reasons = 0;
+    wakeTime = -1.0;
+}
+
+/**
+ * Sleeps until the scheduled wake up or the next event. Events are handled
+ * (callbacks run) before it returns; the caller checks isDirty() again.
+ */
+void RedrawTracker::wait()
+{
+    const double start = glfwGetTime();
+
+    if (wakeTime < 0.0)
+    {
+        glfwWaitEvents();
+    }
+    else if (wakeTime > start)
+    {
+        glfwWaitEventsTimeout(wakeTime - start);
+    }
+    else
+    {
+        glfwPollEvents();
+    }
+
+    const double end = glfwGetTime();
+    if (wakeTime >= 0.0 && end >= wakeTime)
+    {
+        wakeTime = -1.0;
+        reasons |= REDRAW_ANIMATION;
+    }
+
+    waitCount++;
+    waitTime += end - start;
+}
+
+unsigned long RedrawTracker::getDrawCount() const
+{
+    return drawCount;
+}
+
+unsigned long RedrawTracker::getWaitCount() const
+{
+    return waitCount;
+}
+
+// Seconds spent waiting for something to change
+double RedrawTracker::getWaitTime() const
+{
+    return waitTime;
+}
+
+// Frames drawn for reason (one of the REDRAW_* flags)
+unsigned long RedrawTracker::getReasonCount(unsigned int reason) const
+{
+    for (int i = 0; i < REDRAW_REASON_COUNT; i++)
+    {
+        if (reason == (1u << i))
+        {
+            return reasonCounts[i];
+        }
+    }
+    return 0;
+}
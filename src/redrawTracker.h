@@ -0,0 +1,41 @@
+#pragma once
+
+// Why a frame has to be drawn, bit flags
+#define REDRAW_CAMERA 1     // cube angles changed
+#define REDRAW_GAME 2       // new game state
+#define REDRAW_ANIMATION 4  // an animation moved on
+#define REDRAW_WINDOW 8     // window damaged or resized, display settings changed
+#define REDRAW_REASON_COUNT 4
+
+/**
+ * Tracks whether the next frame would differ from the last one drawn.
+ *
+ * Everything that changes the image marks it dirty with a reason; an animation
+ * that will change it later schedules a wake up instead. A clean frame is not
+ * drawn: wait() blocks in glfwWaitEventsTimeout() until the next scheduled wake
+ * up, or until an event (input, window, glfwPostEmptyEvent()) arrives.
+ */
+class RedrawTracker
+{
+    unsigned int reasons = REDRAW_WINDOW; // the first frame is always drawn
+    double wakeTime = -1.0;               // next scheduled wake up, -1 if there is none
+
+    // statistics
+    unsigned long drawCount = 0;
+    unsigned long waitCount = 0;
+    double waitTime = 0.0;
+    unsigned long reasonCounts[REDRAW_REASON_COUNT] = {};
+
+public:
+    void markDirty(unsigned int reason);
+    void scheduleWake(double time);
+    bool isDirty() const;
+
+    void frameDrawn();
+    void wait();
+
+    unsigned long getDrawCount() const;
+    unsigned long getWaitCount() const;
+    double getWaitTime() const;
+    unsigned long getReasonCount(unsigned int reason) const;
+};
@@ -0,0 +1,163 @@
+#include "renderQueue.h"
+
+#include <algorithm>
+
+/**
+ * Sort key of an item: pass and program (8 bits each), VAO, texture and depth
+ * bucket (16 bits each), most expensive state change first.
+ */
+unsigned long long RenderQueue::makeKey(const DrawItem& item)
+{
+    const unsigned int depth = std::min(item.depth, 0xFFFFu);
+
+    return ((unsigned long long) item.pass << 56) |
+           ((unsigned long long) (item.program & 0xFF) << 48) |
+           ((unsigned long long) (item.vao & 0xFFFF) << 32) |
+           ((unsigned long long) (item.texture & 0xFFFF) << 16) |
+           (unsigned long long) depth;
+}
+
+/**
+ * Sets the function used to point the instance attributes of instanced element
+ * draws at their firstInstance (there is no base instance before 4.2).
+ */
+void RenderQueue::setInstanceBinder(InstanceBinder binder)
+{
+    instanceBinder = binder;
+}
+
+void RenderQueue::clear()
+{
+    items.clear();
+    keys.clear();
+}
+
+void RenderQueue::push(const DrawItem& item)
+{
+    items.push_back(item);
+    keys.push_back(makeKey(item));
+}
+
+/**
+ * Sorts the queued items and issues them.
+ *
+ * Nothing bound before the call is assumed to still be bound, so the first item
+ * binds all of its state. Items with equal keys keep the order they were pushed in.
+ * The depth function is left at GL_LESS.
+ */
+void RenderQueue::submit()
+{
+    order.resize(items.size());
+    for (unsigned int i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b)
+    {
+        return keys[a] < keys[b];
+    });
+
+    bool isBound = false;
+    unsigned int boundProgram = 0;
+    unsigned int boundVAO = 0;
+    unsigned int boundTexture = 0;
+    GLenum boundDepthFunc = GL_LESS;
+    unsigned int boundFirstInstance = 0;
+    bool isFirstInstanceBound = false;
+
+    int requested = 0;
+    bindCount = 0;
+
+    for (unsigned int i : order)
+    {
+        const DrawItem& item = items[i];
+
+        requested += 4;
+        if (!isBound || item.program != boundProgram)
+        {
+            glUseProgram(item.program);
+            boundProgram = item.program;
+            bindCount++;
+        }
+        if (!isBound || item.vao != boundVAO)
+        {
+            glBindVertexArray(item.vao);
+            boundVAO = item.vao;
+            isFirstInstanceBound = false; // instance attribute base is VAO state
+            bindCount++;
+        }
+        if (!isBound || item.texture != boundTexture)
+        {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, item.texture);
+            boundTexture = item.texture;
+            bindCount++;
+        }
+        if (!isBound || item.depthFunc != boundDepthFunc)
+        {
+            glDepthFunc(item.depthFunc);
+            boundDepthFunc = item.depthFunc;
+            bindCount++;
+        }
+        isBound = true;
+
+        const bool isInstanced = (item.call == DrawCall::ElementsInstanced || item.call == DrawCall::MultiElementsIndirect);
+        if (isInstanced && instanceBinder != NULL)
+        {
+            requested++;
+            if (!isFirstInstanceBound || item.firstInstance != boundFirstInstance)
+            {
+                instanceBinder(item.firstInstance);
+                boundFirstInstance = item.firstInstance;
+                isFirstInstanceBound = true;
+                bindCount++;
+            }
+        }
+
+        draw(item);
+    }
+
+    if (boundDepthFunc != GL_LESS)
+    {
+        glDepthFunc(GL_LESS);
+    }
+
+    bindsSaved = requested - bindCount;
+}
+
+void RenderQueue::draw(const DrawItem& item)
+{
+    switch (item.call)
+    {
+        case DrawCall::Arrays:
+            glDrawArrays(item.mode, item.first, item.count);
+            break;
+
+        case DrawCall::ElementsInstanced:
+        {
+            const size_t indexSize = (item.indexType == GL_UNSIGNED_BYTE) ? 1 : (item.indexType == GL_UNSIGNED_SHORT) ? 2 : 4;
+            glDrawElementsInstancedBaseVertex(item.mode, item.count, item.indexType, (void *) (item.first * indexSize), item.instanceCount, item.baseVertex);
+            break;
+        }
+
+        case DrawCall::MultiArraysIndirect:
+            glMultiDrawArraysIndirect(item.mode, (void *) item.indirectOffset, item.count, 0);
+            break;
+
+        case DrawCall::MultiElementsIndirect:
+            glMultiDrawElementsIndirect(item.mode, item.indexType, (void *) item.indirectOffset, item.count, 0);
+            break;
+    }
+}
+
+// Binds (program, VAO, texture, depth function, instance base) issued by the last submit().
+int RenderQueue::getBindCount() const
+{
+    return bindCount;
+}
+
+// Binds the last submit() dropped because the state was already bound.
+int RenderQueue::getBindsSaved() const
+{
+    return bindsSaved;
+}
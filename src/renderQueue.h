@@ -0,0 +1,87 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+// Passes of a frame, in the order they are drawn
+enum class RenderPass
+{
+    Opaque,     // scene geometry, fills the depth buffer
+    Background  // full-screen, at the far plane: only shades pixels nothing covered
+};
+
+// GL call a DrawItem is submitted with
+enum class DrawCall
+{
+    Arrays,                 // glDrawArrays(first, count)
+    ElementsInstanced,      // glDrawElementsInstancedBaseVertex(count, first index, instanceCount, baseVertex)
+    MultiArraysIndirect,    // glMultiDrawArraysIndirect(indirectOffset, count commands)
+    MultiElementsIndirect   // glMultiDrawElementsIndirect(indirectOffset, count commands)
+};
+
+/**
+ * One draw, with the state it needs.
+ *
+ * The state fields (program, vao, texture, depthFunc, firstInstance) are bound by the queue,
+ * only when they differ from what the previous item left bound.
+ */
+struct DrawItem
+{
+    // state
+    RenderPass pass = RenderPass::Opaque;
+    unsigned int program = 0;
+    unsigned int vao = 0;
+    unsigned int texture = 0;       // GL_TEXTURE_2D_ARRAY on unit 0
+    GLenum depthFunc = GL_LESS;
+    unsigned int firstInstance = 0; // instance attribute base (instanced element draws only)
+    unsigned int depth = 0;         // bucket, smaller is closer
+
+    // call
+    DrawCall call = DrawCall::Arrays;
+    GLenum mode = GL_TRIANGLES;
+    GLenum indexType = GL_UNSIGNED_BYTE;
+    unsigned int first = 0;
+    unsigned int count = 0;
+    unsigned int instanceCount = 1;
+    int baseVertex = 0;
+    size_t indirectOffset = 0;
+};
+
+// Points the instance attributes of the bound VAO at instance firstInstance.
+typedef void (*InstanceBinder)(unsigned int firstInstance);
+
+/**
+ * Collects the draws of a frame and submits them sorted by state.
+ *
+ * Items are sorted by a key of (pass, program, VAO, texture, depth bucket), so
+ * passes are drawn in order, and within a pass draws sharing state end up next
+ * to each other and are drawn front to back.
+ * Binds of state that is already bound are dropped; the binds saved this way
+ * are counted per frame.
+ */
+class RenderQueue
+{
+    std::vector<DrawItem> items;
+    std::vector<unsigned long long> keys;
+    std::vector<unsigned int> order;
+    InstanceBinder instanceBinder = NULL;
+
+    // statistics of the last submitted frame
+    int bindCount = 0;
+    int bindsSaved = 0;
+
+    static unsigned long long makeKey(const DrawItem& item);
+    void draw(const DrawItem& item);
+
+public:
+    void setInstanceBinder(InstanceBinder binder);
+
+    void clear();
+    void push(const DrawItem& item);
+    void submit();
+
+    int getBindCount() const;
+    int getBindsSaved() const;
+};
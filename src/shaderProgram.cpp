@@ -0,0 +1,151 @@
+#include "shaderProgram.h"
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+std::vector<std::pair<std::string, unsigned int>> ShaderProgram::sharedUniformBlocks;
+
+/**
+ * Registers a uniform block that every program linked from now on gets bound to
+ * the given binding point (if the program declares the block).
+ */
+void ShaderProgram::addSharedUniformBlock(const std::string& name, unsigned int binding)
+{
+    sharedUniformBlocks.push_back(std::make_pair(name, binding));
+}
+
+/**
+ * Compiles and links the program from its vertex and fragment shader sources.
+ * Compile and link errors are logged. Returns true if the program linked.
+ */
+bool ShaderProgram::compile(const char *vertexShaderSource, const char *fragmentShaderSource)
+{
+    unsigned int vertexShader, fragmentShader;
+    int success;
+    char infoLog[512];
+
+    // Create vertex shader
+    vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
+    glCompileShader(vertexShader);
+
+    // If compilation failed, log it
+    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+
+    // Create fragment shader
+    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
+    glCompileShader(fragmentShader);
+
+    // If compilation failed, log it
+    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+
+    // Create shader program
+    id = glCreateProgram();
+    glAttachShader(id, vertexShader);
+    glAttachShader(id, fragmentShader);
+    glLinkProgram(id);
+
+    // Delete shaders
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    // If linking failed, log it
+    glGetProgramiv(id, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(id, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        return false;
+    }
+
+    resolveLocations();
+    bindSharedUniformBlocks();
+
+    return true;
+}
+
+/**
+ * Queries the location of every active uniform of the linked program.
+ */
+void ShaderProgram::resolveLocations()
+{
+    char name[256];
+    int count, size;
+    GLenum type;
+
+    uniformLocations.clear();
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+    for (int i = 0; i < count; i++)
+    {
+        glGetActiveUniform(id, i, sizeof(name), NULL, &size, &type, name);
+
+        // arrays are reported as "name[0]", store them by their plain name
+        std::string uniformName = name;
+        if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+        {
+            uniformName.resize(uniformName.size() - 3);
+        }
+
+        uniformLocations[uniformName] = glGetUniformLocation(id, name);
+    }
+}
+
+void ShaderProgram::bindSharedUniformBlocks()
+{
+    for (const auto& block : sharedUniformBlocks)
+    {
+        unsigned int index = glGetUniformBlockIndex(id, block.first.c_str());
+        if (index != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(id, index, block.second);
+        }
+    }
+}
+
+void ShaderProgram::use() const
+{
+    glUseProgram(id);
+}
+
+unsigned int ShaderProgram::getId() const
+{
+    return id;
+}
+
+/**
+ * The location of a uniform, or -1 if the program has no such active uniform.
+ * Served from the locations resolved at link time (no driver call).
+ */
+int ShaderProgram::getUniformLocation(const std::string& name) const
+{
+    auto it = uniformLocations.find(name);
+    return (it == uniformLocations.end()) ? -1 : it->second;
+}
+
+void ShaderProgram::setInt(int location, int value) const
+{
+    glUniform1i(location, value);
+}
+
+void ShaderProgram::setFloat(int location, float value) const
+{
+    glUniform1f(location, value);
+}
+
+// values: count column major 3x3 matrices
+void ShaderProgram::setMat3Array(int location, const float * values, int count) const
+{
+    glUniformMatrix3fv(location, count, GL_FALSE, values);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * A linked OpenGL shader program.
+ * 
+ * Every active uniform location is resolved once when the program is linked.
+ * Callers look up the locations they need at setup time and pass them to the
+ * typed setters, so no string lookup reaches the driver while rendering.
+ * 
+ * Uniform blocks registered with addSharedUniformBlock() are bound to their
+ * binding point in every program linked afterwards.
+ */
+class ShaderProgram
+{
+    unsigned int id = 0;
+    std::unordered_map<std::string, int> uniformLocations;
+
+    static std::vector<std::pair<std::string, unsigned int>> sharedUniformBlocks;
+
+    void resolveLocations();
+    void bindSharedUniformBlocks();
+
+public:
+    static void addSharedUniformBlock(const std::string& name, unsigned int binding);
+
+    bool compile(const char *vertexShaderSource, const char *fragmentShaderSource);
+    void use() const;
+    unsigned int getId() const;
+
+    int getUniformLocation(const std::string& name) const;
+
+    // Setters act on the program currently in use (see use()).
+    void setInt(int location, int value) const;
+    void setFloat(int location, float value) const;
+    void setMat3Array(int location, const float * values, int count) const;
+};
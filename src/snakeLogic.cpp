@@ -24,6 +24,10 @@ SnakeLogic::SnakeLogic()
 
 void SnakeLogic::move(Direction dir)
 {
+    generation++;
+    lastChange = SnakeChange();
+    lastChange.moved = true;
+
     eatApple();
 
     // Ignore direction that moves snake backwards
@@ -78,6 +82,9 @@ void SnakeLogic::move(Direction dir)
 
     snake[0].dir = dir;
 
+    // old head now points at the new head
+    lastChange.neckTurned = (snake[1].dir != dir);
+
     for (int i = 1; i < snakeSize; i++)
     {
         SnakePart& cur = snake[i];
@@ -144,6 +151,10 @@ void SnakeLogic::reset()
     snakeSize = 3;
     applesSize = 0;
     moveCountSinceLastAppleGen = 0;
+
+    generation++;
+    lastChange = SnakeChange();
+    lastChange.reset = true;
 }
 
 /**
@@ -201,6 +212,7 @@ void SnakeLogic::generateApple()
 
         apples[applesSize] = apple;
         applesSize++;
+        lastChange.applesChanged = true;
 
         return;
     }
@@ -260,7 +272,28 @@ void SnakeLogic::eatApple()
             // Eat apple, and snake grows
             applesSize--;
             snakeSize++;
+            lastChange.applesChanged = true;
+            lastChange.grew = true;
             return;
         }
     }
+}
+
+/**
+ * Counter that is incremented every time the game state changes (move or reset).
+ * 
+ * If it went up by exactly one since it was last read, getLastChange() tells what
+ * changed, so a renderer can patch only the affected parts.
+ */
+unsigned int SnakeLogic::getGeneration()
+{
+    return generation;
+}
+
+/**
+ * What the most recent state change did (see getGeneration()).
+ */
+const SnakeChange& SnakeLogic::getLastChange()
+{
+    return lastChange;
 }
\ No newline at end of file
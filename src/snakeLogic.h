@@ -23,6 +23,16 @@ struct Apple
     Apple(int x, int y, int z);
 };
 
+// What the last state change (see SnakeLogic::getGeneration) did.
+struct SnakeChange
+{
+    bool moved = false;            // new head at index 0, all other parts shifted back by one
+    bool grew = false;             // snake grew while moving (tail stayed in place)
+    bool neckTurned = false;       // part at index 1 (the old head) changed direction
+    bool reset = false;            // whole game state was replaced
+    bool applesChanged = false;    // an apple was spawned or eaten
+};
+
 class SnakeLogic
 {
     SnakePart snake[MAX_SNAKE_SIZE];
@@ -32,6 +42,8 @@ class SnakeLogic
     int applesSize = 0;
     int moveCountSinceLastAppleGen = 0;
     int appleGenRate = 7;
+    unsigned int generation = 0;
+    SnakeChange lastChange;
 
 public:
     SnakeLogic();
@@ -44,4 +56,6 @@ public:
     const Apple * getApples();
     const int getApplesSize();
     void eatApple();
+    unsigned int getGeneration();
+    const SnakeChange& getLastChange();
 };
\ No newline at end of file
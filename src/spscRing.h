@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+
+/**
+ * Lock-free single producer, single consumer ring of at most Capacity - 1 values.
+ *
+ * The writer push()es, the reader pop()s; neither ever blocks. Each side only
+ * stores its own index, and reads the other side's index to see how far it may
+ * go. A push() into a full ring fails, so the writer decides what to drop.
+ */
+template <typename T, unsigned int Capacity>
+class SpscRing
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static const unsigned int INDEX_MASK = Capacity - 1;
+
+    T values[Capacity];
+    std::atomic<unsigned int> head{0}; // next value to pop, owned by the reader
+    std::atomic<unsigned int> tail{0}; // next slot to push into, owned by the writer
+
+public:
+    // writer side: returns false if the ring is full
+    bool push(const T& value)
+    {
+        const unsigned int t = tail.load(std::memory_order_relaxed);
+        const unsigned int next = (t + 1) & INDEX_MASK;
+        if (next == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        values[t] = value;
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // reader side: returns false if the ring is empty
+    bool pop(T& value)
+    {
+        const unsigned int h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        value = values[h];
+        head.store((h + 1) & INDEX_MASK, std::memory_order_release);
+        return true;
+    }
+};
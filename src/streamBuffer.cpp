@@ -0,0 +1,141 @@
+#include "streamBuffer.h"
+
+#include <GLFW/glfw3.h>
+
+void StreamBuffer::create(GLenum target, size_t regionSize)
+{
+    this->target = target;
+    this->regionSize = regionSize;
+    region = STREAM_BUFFER_REGIONS - 1; // first map() moves to region 0
+
+    glGenBuffers(1, &id);
+    glBindBuffer(target, id);
+
+    if (GLAD_GL_VERSION_4_4)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, regionSize * STREAM_BUFFER_REGIONS, NULL, flags);
+        persistentData = (unsigned char *) glMapBufferRange(target, 0, regionSize * STREAM_BUFFER_REGIONS, flags);
+    }
+    else
+    {
+        glBufferData(target, regionSize * STREAM_BUFFER_REGIONS, NULL, GL_STREAM_DRAW);
+    }
+}
+
+/**
+ * Blocks until the GPU is done with the current region (its fence is signaled).
+ * Waits that actually block are counted.
+ */
+void StreamBuffer::waitForRegion()
+{
+    GLsync& regionFence = fences[region];
+    if (regionFence == NULL)
+    {
+        return;
+    }
+
+    // already signaled? (the common case)
+    if (glClientWaitSync(regionFence, 0, 0) == GL_TIMEOUT_EXPIRED)
+    {
+        const double start = glfwGetTime();
+        waitCount++;
+
+        // flush so the fence is guaranteed to signal
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        while (true)
+        {
+            GLenum status = glClientWaitSync(regionFence, flags, 1000000); // 1 ms
+            if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED)
+            {
+                break;
+            }
+            flags = 0;
+        }
+
+        waitTime += glfwGetTime() - start;
+    }
+
+    glDeleteSync(regionFence);
+    regionFence = NULL;
+}
+
+/**
+ * Moves to the next region and returns a pointer to write it through.
+ * The region holds regionSize bytes, and starts at getRegionOffset() in the buffer.
+ * Call unmap() once written, and fence() after the draws that read it.
+ */
+void * StreamBuffer::map()
+{
+    region = (region + 1) % STREAM_BUFFER_REGIONS;
+    mapCount++;
+
+    waitForRegion();
+
+    if (persistentData != NULL)
+    {
+        return persistentData + getRegionOffset();
+    }
+
+    // fence already guarantees the GPU is done with the region
+    glBindBuffer(target, id);
+    return glMapBufferRange(target, getRegionOffset(), regionSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+void StreamBuffer::unmap()
+{
+    if (persistentData == NULL)
+    {
+        glBindBuffer(target, id);
+        glUnmapBuffer(target);
+    }
+}
+
+/**
+ * Fences the current region, call after submitting the draws that read it.
+ */
+void StreamBuffer::fence()
+{
+    if (fences[region] != NULL)
+    {
+        glDeleteSync(fences[region]);
+    }
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+unsigned int StreamBuffer::getId() const
+{
+    return id;
+}
+
+/**
+ * Byte offset of the current region in the buffer.
+ */
+size_t StreamBuffer::getRegionOffset() const
+{
+    return region * regionSize;
+}
+
+/**
+ * Number of regions mapped so far.
+ */
+unsigned long StreamBuffer::getMapCount() const
+{
+    return mapCount;
+}
+
+/**
+ * Number of times map() had to block on a fence because the GPU was still reading the region.
+ */
+unsigned long StreamBuffer::getWaitCount() const
+{
+    return waitCount;
+}
+
+/**
+ * Total time spent blocked on fences (seconds).
+ */
+double StreamBuffer::getWaitTime() const
+{
+    return waitTime;
+}
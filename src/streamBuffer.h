@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Regions of a stream buffer, the CPU can run this many frames ahead of the GPU.
+#define STREAM_BUFFER_REGIONS 3
+
+/**
+ * Ring buffer for streaming per-frame data to the GPU. Only the indirect draw
+ * commands use it: entity instances change with the game state, not every frame,
+ * and are patched in place in their own static buffer instead.
+ * 
+ * The buffer is split into STREAM_BUFFER_REGIONS regions. Each frame maps the next
+ * region, writes it and fences it once the draws reading it are submitted. Before a
+ * region is written again its fence is waited on, so the CPU never overwrites data
+ * the GPU still reads, and the driver never has to sync or reallocate implicitly.
+ * 
+ * On 4.4 contexts the buffer is persistently mapped once (glBufferStorage), older
+ * contexts map each region unsynchronized with glMapBufferRange.
+ */
+class StreamBuffer
+{
+    unsigned int id = 0;
+    GLenum target = GL_ARRAY_BUFFER;
+    size_t regionSize = 0;
+    int region = 0;
+    GLsync fences[STREAM_BUFFER_REGIONS] = {};
+    unsigned char * persistentData = NULL;
+
+    // statistics
+    unsigned long mapCount = 0;
+    unsigned long waitCount = 0;
+    double waitTime = 0.0; // seconds
+
+    void waitForRegion();
+
+public:
+    void create(GLenum target, size_t regionSize);
+    void * map();
+    void unmap();
+    void fence();
+
+    unsigned int getId() const;
+    size_t getRegionOffset() const;
+
+    unsigned long getMapCount() const;
+    unsigned long getWaitCount() const;
+    double getWaitTime() const;
+};
@@ -0,0 +1,345 @@
+#include "terrain.h"
+#include "cubeGeometry.h"
+#include <algorithm>
+#include <cmath>
+
+// Grid offset of the neighbour each face of CUBE_POSITIONS looks at
+// (front, back, top, left, right, bottom).
+static const int FACE_NEIGHBOURS[6][3] =
+{
+    { 0,  0,  1},
+    { 0,  0, -1},
+    { 0,  1,  0},
+    {-1,  0,  0},
+    { 1,  0,  0},
+    { 0, -1,  0}
+};
+
+static const int STARTING_INDEX = TERRAIN_CUBE_SIZE - ceil(((double) TERRAIN_CUBE_SIZE)/2.0); // positive
+static const int LAST_INDEX = STARTING_INDEX - (TERRAIN_CUBE_SIZE - 1); // negative
+
+/**
+ * Checks if there is a dirt block at grid position (x,y,z).
+ * 
+ * The terrain is a solid box of dirt with the cube the snake moves in carved out of it.
+ */
+static bool isDirt(int x, int y, int z)
+{
+    // outside of terrain
+    if (
+        y > STARTING_INDEX || y < LAST_INDEX - TERRAIN_PADDING ||
+        x > STARTING_INDEX + TERRAIN_PADDING || x < LAST_INDEX - TERRAIN_PADDING ||
+        z > STARTING_INDEX || z < LAST_INDEX - TERRAIN_PADDING
+    )
+    {
+        return false;
+    }
+
+    // zone where worm moves
+    if (
+        y <= STARTING_INDEX && y >= LAST_INDEX &&
+        x <= STARTING_INDEX && x >= LAST_INDEX &&
+        z <= STARTING_INDEX && z >= LAST_INDEX
+    )
+    {
+        return false;
+    }
+
+    return true;
+}
+
+// Tile-local texture mapping of one cube face: local uv = (s, t) where
+// s = su * u + sv * v + s0 and t = tu * u + tv * v + t0, with (u, v) the
+// world coordinates along the two axes of the face plane.
+struct FaceMapping
+{
+    float su, sv, s0;
+    float tu, tv, t0;
+    float layer;
+};
+
+/**
+ * Derives the tile-local texture mapping of a face from the unit cube data,
+ * so merged faces repeat the tile exactly like a row of single blocks would.
+ */
+static FaceMapping makeFaceMapping(const float * texCoords, int face, int uAxis, int vAxis)
+{
+    FaceMapping mapping;
+
+    // tile the face samples from (lower left corner in the atlas grid)
+    const int tileColumn = getCubeFaceTile(texCoords, face, 0, ATLAS_COLUMNS);
+    const int tileRow = getCubeFaceTile(texCoords, face, 1, ATLAS_ROWS);
+    mapping.layer = getAtlasLayer(tileColumn, tileRow);
+
+    // solve the affine mapping from the first triangle of the face
+    const float * p0 = &CUBE_POSITIONS[(face * 6 + 0) * 3];
+    const float * p1 = &CUBE_POSITIONS[(face * 6 + 1) * 3];
+    const float * p2 = &CUBE_POSITIONS[(face * 6 + 2) * 3];
+    const float * uv0 = &texCoords[(face * 6 + 0) * 2];
+    const float * uv1 = &texCoords[(face * 6 + 1) * 2];
+    const float * uv2 = &texCoords[(face * 6 + 2) * 2];
+
+    const float du1 = p1[uAxis] - p0[uAxis], dv1 = p1[vAxis] - p0[vAxis];
+    const float du2 = p2[uAxis] - p0[uAxis], dv2 = p2[vAxis] - p0[vAxis];
+    const float det = du1 * dv2 - du2 * dv1;
+
+    const float ds1 = (uv1[0] - uv0[0]) * ATLAS_COLUMNS, ds2 = (uv2[0] - uv0[0]) * ATLAS_COLUMNS;
+    const float dt1 = (uv1[1] - uv0[1]) * ATLAS_ROWS, dt2 = (uv2[1] - uv0[1]) * ATLAS_ROWS;
+
+    mapping.su = (ds1 * dv2 - ds2 * dv1) / det;
+    mapping.sv = (du1 * ds2 - du2 * ds1) / det;
+    mapping.tu = (dt1 * dv2 - dt2 * dv1) / det;
+    mapping.tv = (du1 * dt2 - du2 * dt1) / det;
+
+    mapping.s0 = uv0[0] * ATLAS_COLUMNS - tileColumn - mapping.su * p0[uAxis] - mapping.sv * p0[vAxis];
+    mapping.t0 = uv0[1] * ATLAS_ROWS - tileRow - mapping.tu * p0[uAxis] - mapping.tv * p0[vAxis];
+
+    return mapping;
+}
+
+/**
+ * Greedy meshes the dirt blocks inside the inclusive block range [MIN, MAX]
+ * and appends their faces to vertices.
+ * 
+ * Only faces that border empty space (the snake cube or the outside of the
+ * terrain) are kept, since every other face is covered by a neighbouring
+ * block. Coplanar faces showing the same tile are then merged into maximal
+ * rectangles. Merged faces carry tile-local texture coordinates that run
+ * from 0 to the rectangle size, so the tile's atlas layer repeats across the
+ * rectangle (GL_REPEAT).
+ */
+static void meshBlocks(const int MIN[3], const int MAX[3], std::vector<float>& vertices)
+{
+    for (int face = 0; face < 6; face++)
+    {
+        // axis the face looks along, and the two axes of its plane
+        int nAxis = 0;
+        while (FACE_NEIGHBOURS[face][nAxis] == 0)
+        {
+            nAxis++;
+        }
+        const int uAxis = (nAxis + 1) % 3;
+        const int vAxis = (nAxis + 2) % 3;
+
+        // block types: 1 = dirt, 2 = dirt with grass
+        const FaceMapping mappings[3] = 
+        {
+            FaceMapping(),
+            makeFaceMapping(getCubeTexCoords(CubeVariant::Dirt), face, uAxis, vAxis),
+            makeFaceMapping(getCubeTexCoords(CubeVariant::DirtWithGrass), face, uAxis, vAxis)
+        };
+
+        const int uSize = MAX[uAxis] - MIN[uAxis] + 1;
+        const int vSize = MAX[vAxis] - MIN[vAxis] + 1;
+        std::vector<int> mask(uSize * vSize);
+
+        for (int n = MIN[nAxis]; n <= MAX[nAxis]; n++)
+        {
+            // Mark exposed faces of this slice with their block type
+            for (int v = 0; v < vSize; v++)
+            {
+                for (int u = 0; u < uSize; u++)
+                {
+                    int block[3];
+                    block[nAxis] = n;
+                    block[uAxis] = MIN[uAxis] + u;
+                    block[vAxis] = MIN[vAxis] + v;
+
+                    int type = 0;
+                    if (
+                        isDirt(block[0], block[1], block[2]) &&
+                        !isDirt(block[0] + FACE_NEIGHBOURS[face][0], block[1] + FACE_NEIGHBOURS[face][1], block[2] + FACE_NEIGHBOURS[face][2])
+                    )
+                    {
+                        // top layer has grass
+                        type = (block[1] == STARTING_INDEX) ? 2 : 1;
+                    }
+                    mask[v * uSize + u] = type;
+                }
+            }
+
+            // Merge marked faces into maximal rectangles
+            for (int v = 0; v < vSize; v++)
+            {
+                for (int u = 0; u < uSize; )
+                {
+                    const int type = mask[v * uSize + u];
+                    if (type == 0)
+                    {
+                        u++;
+                        continue;
+                    }
+
+                    // grow along u, then along v while the whole row matches
+                    int width = 1;
+                    while (u + width < uSize && mask[v * uSize + u + width] == type)
+                    {
+                        width++;
+                    }
+
+                    int height = 1;
+                    bool rowMatches = true;
+                    while (v + height < vSize && rowMatches)
+                    {
+                        for (int k = 0; k < width; k++)
+                        {
+                            if (mask[(v + height) * uSize + u + k] != type)
+                            {
+                                rowMatches = false;
+                                break;
+                            }
+                        }
+                        if (rowMatches)
+                        {
+                            height++;
+                        }
+                    }
+
+                    for (int j = 0; j < height; j++)
+                    {
+                        for (int k = 0; k < width; k++)
+                        {
+                            mask[(v + j) * uSize + u + k] = 0;
+                        }
+                    }
+
+                    // Emit the unit face stretched over the rectangle (keeps winding)
+                    const FaceMapping& mapping = mappings[type];
+                    for (int i = face * 6; i < face * 6 + 6; i++)
+                    {
+                        const float * corner = &CUBE_POSITIONS[i * 3];
+
+                        float position[3];
+                        position[nAxis] = n + corner[nAxis];
+                        position[uAxis] = MIN[uAxis] + u + ((corner[uAxis] < 0) ? -0.5f : width - 0.5f);
+                        position[vAxis] = MIN[vAxis] + v + ((corner[vAxis] < 0) ? -0.5f : height - 0.5f);
+
+                        vertices.push_back(position[0]);
+                        vertices.push_back(position[1]);
+                        vertices.push_back(position[2]);
+                        vertices.push_back(mapping.su * position[uAxis] + mapping.sv * position[vAxis] + mapping.s0);
+                        vertices.push_back(mapping.tu * position[uAxis] + mapping.tv * position[vAxis] + mapping.t0);
+                        vertices.push_back(mapping.layer);
+                    }
+
+                    u += width;
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * Meshes the blocks of the chunk of the given level starting at chunkMin (clamped
+ * to the terrain bounds MAX), then its children one level down.
+ * 
+ * Returns the index of the chunk, or -1 if it has no visible face (its children
+ * can't have any either).
+ */
+static int bakeChunk(const int chunkMin[3], int level, const int MAX[3], std::vector<float>& vertices, std::vector<TerrainChunk>& chunks)
+{
+    const int size = TERRAIN_CHUNK_SIZE << level;
+    const int chunkMax[3] = 
+    {
+        std::min(chunkMin[0] + size - 1, MAX[0]),
+        std::min(chunkMin[1] + size - 1, MAX[1]),
+        std::min(chunkMin[2] + size - 1, MAX[2])
+    };
+
+    TerrainChunk chunk;
+    chunk.firstVertex = vertices.size() / TERRAIN_VERTEX_SIZE;
+    meshBlocks(chunkMin, chunkMax, vertices);
+    chunk.vertexCount = vertices.size() / TERRAIN_VERTEX_SIZE - chunk.firstVertex;
+    chunk.level = level;
+    chunk.childCount = 0;
+
+    if (chunk.vertexCount == 0)
+    {
+        return -1;
+    }
+
+    // bounding box of the faces that were emitted
+    for (int axis = 0; axis < 3; axis++)
+    {
+        chunk.min[axis] = vertices[chunk.firstVertex * TERRAIN_VERTEX_SIZE + axis];
+        chunk.max[axis] = chunk.min[axis];
+    }
+    for (int v = chunk.firstVertex; v < chunk.firstVertex + chunk.vertexCount; v++)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            chunk.min[axis] = std::min(chunk.min[axis], vertices[v * TERRAIN_VERTEX_SIZE + axis]);
+            chunk.max[axis] = std::max(chunk.max[axis], vertices[v * TERRAIN_VERTEX_SIZE + axis]);
+        }
+    }
+
+    const int index = chunks.size();
+    chunks.push_back(chunk);
+
+    if (level == 0)
+    {
+        return index;
+    }
+
+    const int half = size / 2;
+    for (int y = chunkMin[1]; y <= chunkMax[1]; y += half)
+    {
+        for (int x = chunkMin[0]; x <= chunkMax[0]; x += half)
+        {
+            for (int z = chunkMin[2]; z <= chunkMax[2]; z += half)
+            {
+                const int childMin[3] = {x, y, z};
+                const int child = bakeChunk(childMin, level - 1, MAX, vertices, chunks);
+                if (child >= 0)
+                {
+                    chunks[index].children[chunks[index].childCount++] = child;
+                }
+            }
+        }
+    }
+
+    return index;
+}
+
+/**
+ * Meshes the dirt blocks surrounding the cube the snake moves in into one
+ * vertex array, split into chunks so the renderer can skip chunks that are
+ * out of view. Chunks without any visible face are left out.
+ * 
+ * Every level of detail is baked: chunks of the coarsest level
+ * (TERRAIN_CHUNK_SIZE << (TERRAIN_LOD_LEVELS - 1) blocks) are the roots, each
+ * split into up to 8 children down to TERRAIN_CHUNK_SIZE. Faces are greedy merged
+ * within a chunk only, so coarse chunks are the same surface in fewer, larger
+ * slabs: the renderer can draw a distant region as one coarse chunk and a close
+ * one as its finer children (better culling) without any visible difference.
+ * 
+ * Faces are pre-translated to their grid position, so the terrain can be
+ * drawn with only the shared parent rotation as its model matrix.
+ * 
+ * Vertices are interleaved: position (x,y,z), tile-local texture coordinates
+ * (s,t) and atlas layer.
+ */
+void bakeTerrain(std::vector<float>& vertices, std::vector<TerrainChunk>& chunks)
+{
+    // inclusive terrain bounds per axis
+    const int MIN[3] = {LAST_INDEX - TERRAIN_PADDING, LAST_INDEX - TERRAIN_PADDING, LAST_INDEX - TERRAIN_PADDING};
+    const int MAX[3] = {STARTING_INDEX + TERRAIN_PADDING, STARTING_INDEX, STARTING_INDEX};
+
+    const int ROOT_SIZE = TERRAIN_CHUNK_SIZE << (TERRAIN_LOD_LEVELS - 1);
+
+    vertices.clear();
+    chunks.clear();
+
+    for (int y = MIN[1]; y <= MAX[1]; y += ROOT_SIZE)
+    {
+        for (int x = MIN[0]; x <= MAX[0]; x += ROOT_SIZE)
+        {
+            for (int z = MIN[2]; z <= MAX[2]; z += ROOT_SIZE)
+            {
+                const int chunkMin[3] = {x, y, z};
+                bakeChunk(chunkMin, TERRAIN_LOD_LEVELS - 1, MAX, vertices, chunks);
+            }
+        }
+    }
+}
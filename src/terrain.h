@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+// Size of the cube the snake moves in (must match SnakeLogic).
+#define TERRAIN_CUBE_SIZE 5
+// How far the dirt extends past the snake cube (sides and below).
+#define TERRAIN_PADDING 15
+// Blocks per axis in one terrain chunk of the finest level (unit of frustum culling)
+#define TERRAIN_CHUNK_SIZE 8
+// Levels of detail: a chunk of level L spans TERRAIN_CHUNK_SIZE << L blocks per axis
+// and is also split into up to 8 chunks of level L - 1.
+#define TERRAIN_LOD_LEVELS 3
+// Floats per baked vertex: position (3) + tile-local texture coordinates (2) + atlas layer (1).
+#define TERRAIN_VERTEX_SIZE 6
+
+// A range of the baked terrain vertices and its bounding box.
+// Chunks form a tree: the children mesh the same blocks as their parent, in smaller pieces.
+struct TerrainChunk
+{
+    int firstVertex;
+    int vertexCount;
+    float min[3];
+    float max[3];
+    int level;          // 0 is the finest
+    int children[8];    // chunk indices
+    int childCount;
+};
+
+void bakeTerrain(std::vector<float>& vertices, std::vector<TerrainChunk>& chunks);
@@ -0,0 +1,110 @@
+#include "textureAtlas.h"
+
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * Slices the ATLAS_COLUMNS x ATLAS_ROWS tile grid of an RGBA8 atlas into one image
+ * per tile, in layer order (see getAtlasLayer()).
+ */
+void sliceAtlasTiles(const unsigned char * pixels, int width, int height, std::vector<AtlasImage>& tiles)
+{
+    const int tileWidth = width / ATLAS_COLUMNS;
+    const int tileHeight = height / ATLAS_ROWS;
+
+    tiles.resize(ATLAS_LAYER_COUNT);
+
+    for (int row = 0; row < ATLAS_ROWS; row++)
+    {
+        for (int column = 0; column < ATLAS_COLUMNS; column++)
+        {
+            AtlasImage& tile = tiles[getAtlasLayer(column, row)];
+            tile.width = tileWidth;
+            tile.height = tileHeight;
+            tile.pixels.resize(tileWidth * tileHeight * 4);
+
+            for (int y = 0; y < tileHeight; y++)
+            {
+                const unsigned char * source = pixels + ((row * tileHeight + y) * width + column * tileWidth) * 4;
+                std::copy(source, source + tileWidth * 4, tile.pixels.begin() + y * tileWidth * 4);
+            }
+        }
+    }
+}
+
+/**
+ * Number of mip levels (including the base level) of a tile: levels are halved
+ * while both dimensions divide evenly.
+ */
+int getAtlasMipLevelCount(const AtlasImage& tile)
+{
+    int width = tile.width;
+    int height = tile.height;
+
+    int count = 1;
+    while (width % 2 == 0 && height % 2 == 0)
+    {
+        width /= 2;
+        height /= 2;
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * Builds the next mip level of source with a 2x2 box filter (rounded average).
+ * Source dimensions must be even.
+ */
+void downsampleAtlas(const AtlasImage& source, AtlasImage& level)
+{
+    level.width = source.width / 2;
+    level.height = source.height / 2;
+    level.pixels.resize(level.width * level.height * 4);
+
+    const int sourceStride = source.width * 4;
+
+    for (int y = 0; y < level.height; y++)
+    {
+        const unsigned char * row0 = source.pixels.data() + (2 * y) * sourceStride;
+        const unsigned char * row1 = row0 + sourceStride;
+        unsigned char * target = level.pixels.data() + y * level.width * 4;
+
+        int x = 0;
+
+#ifdef __SSE2__
+        // two output pixels (4x2 source pixels) per step, summed in 16 bits
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rounding = _mm_set1_epi16(2);
+        for (; x + 2 <= level.width; x += 2)
+        {
+            const __m128i a = _mm_loadu_si128((const __m128i *) (row0 + x * 8));
+            const __m128i b = _mm_loadu_si128((const __m128i *) (row1 + x * 8));
+
+            // vertical sums of source pixels 0,1 and 2,3
+            const __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            const __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+            // horizontal sums: pixel 0 + 1 and pixel 2 + 3
+            const __m128i sum = _mm_unpacklo_epi64(
+                _mm_add_epi16(low, _mm_srli_si128(low, 8)),
+                _mm_add_epi16(high, _mm_srli_si128(high, 8)));
+
+            const __m128i average = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+            _mm_storel_epi64((__m128i *) (target + x * 4), _mm_packus_epi16(average, average));
+        }
+#endif
+
+        for (; x < level.width; x++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                const int sum = row0[x * 8 + c] + row0[x * 8 + 4 + c] + row1[x * 8 + c] + row1[x * 8 + 4 + c];
+                target[x * 4 + c] = (unsigned char) ((sum + 2) / 4);
+            }
+        }
+    }
+}
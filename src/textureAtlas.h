@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+
+#include "cubeGeometry.h"
+
+// RGBA8 image, rows bottom to top (as loaded with stbi_set_flip_vertically_on_load).
+struct AtlasImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+};
+
+void sliceAtlasTiles(const unsigned char * pixels, int width, int height, std::vector<AtlasImage>& tiles);
+int getAtlasMipLevelCount(const AtlasImage& tile);
+void downsampleAtlas(const AtlasImage& source, AtlasImage& level);
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+
+/**
+ * Lock-free single producer, single consumer triple buffer.
+ *
+ * The writer fills getBack() and publish()es it; the reader calls update() to
+ * pick up the most recently published value and reads it through getFront().
+ * Neither side ever blocks or waits for the other: the third buffer sits in the
+ * middle and is swapped atomically with the writer's or reader's own buffer.
+ * Values published while the reader doesn't update are overwritten (only the
+ * latest matters).
+ */
+template <typename T>
+class TripleBuffer
+{
+    // set in middle when it holds a value the reader hasn't picked up yet
+    static const int NEW_BIT = 4;
+    static const int INDEX_MASK = 3;
+
+    T buffers[3];
+    std::atomic<int> middle{1};
+    int back = 0;  // owned by the writer
+    int front = 2; // owned by the reader
+
+public:
+    // writer side
+
+    T& getBack()
+    {
+        return buffers[back];
+    }
+
+    /**
+     * Hands getBack() to the reader.
+     * Returns false if it replaced a value the reader never picked up.
+     */
+    bool publish()
+    {
+        const int old = middle.exchange(back | NEW_BIT, std::memory_order_acq_rel);
+        back = old & INDEX_MASK;
+        return (old & NEW_BIT) == 0;
+    }
+
+    // reader side
+
+    /**
+     * Swaps in the latest published value, if there is one.
+     * Returns true if getFront() changed.
+     */
+    bool update()
+    {
+        if ((middle.load(std::memory_order_relaxed) & NEW_BIT) == 0)
+        {
+            return false;
+        }
+
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    const T& getFront() const
+    {
+        return buffers[front];
+    }
+};